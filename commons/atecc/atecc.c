@@ -1,37 +1,85 @@
 #include "atecc.h"
 
+#include "../crc/crc.h"
+
 #include <linux/delay.h>
+#include <linux/hw_random.h>
 #include <linux/i2c.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+
+#define ATECC_PROBE_TRIES 10
+#define ATECC_RANDOM_EXEC_MAX_MS 23
+#define ATECC_RNG_BLOCK_SIZE 32
+#define ATECC_RNG_BLOCKS 4
+#define ATECC_RNG_QUALITY_DEFAULT 64
+#define ATECC_RNG_QUALITY_MAX 1024
+
+static ushort rngQuality = ATECC_RNG_QUALITY_DEFAULT;
+module_param_named(atecc_rng_quality, rngQuality, ushort, 0444);
+MODULE_PARM_DESC(atecc_rng_quality,
+                 "Bits of entropy credited per 1024 bits read from the "
+                 "secure element RNG, 1 - 1024 (default="
+                 __MODULE_STRING(ATECC_RNG_QUALITY_DEFAULT) ")");
+
+enum AteccState {
+  ATECC_STATE_UNKNOWN = 0,
+  ATECC_STATE_PRESENT,
+  ATECC_STATE_ABSENT,
+};
 
 struct AteccBean {
   uint8_t serialNumber[9];
   bool probed;
+  // published with release semantics once the serial is cached
+  enum AteccState state;
+  struct i2c_client *client;
+  bool driverAdded;
 };
 
 static struct AteccBean _atecc = {
     .probed = false,
+    .state = ATECC_STATE_UNKNOWN,
+    .client = NULL,
+    .driverAdded = false,
+};
+
+static DEFINE_MUTEX(_ateccLock);
+
+/*
+ * Random numbers fetched ahead of demand: buf[0, avail) is not served
+ * yet, and is topped up in background when half of it was consumed.
+ */
+struct AteccRng {
+  struct hwrng hwrng;
+  bool registered;
+  struct mutex lock;
+  uint8_t buf[ATECC_RNG_BLOCK_SIZE * ATECC_RNG_BLOCKS];
+  size_t avail;
+  struct work_struct fillWork;
+  unsigned long bytes;
+  unsigned long blockCnt;
+  unsigned long errCnt;
+  u64 blockTimeTot_ns;
+  u64 blockTimeMax_ns;
+};
+
+static void _ateccRngFillWork(struct work_struct *work);
+
+static struct AteccRng _ateccRng = {
+    .registered = false,
+    .lock = __MUTEX_INITIALIZER(_ateccRng.lock),
+    .avail = 0,
+    .fillWork = __WORK_INITIALIZER(_ateccRng.fillWork, _ateccRngFillWork),
 };
 
 static void _getCRC16LittleEndian(size_t length, const uint8_t *data,
                                   uint8_t *crc_le) {
-  size_t counter;
-  uint16_t crc = 0;
-  uint16_t polynom = 0x8005;
-  uint8_t shift;
-  uint8_t data_bit, crc_bit;
-
-  for (counter = 0; counter < length; counter++) {
-    for (shift = 0x01; shift > 0x00; shift <<= 1) {
-      data_bit = (data[counter] & shift) ? 1 : 0;
-      crc_bit = crc >> 15;
-      crc <<= 1;
-      if (data_bit != crc_bit) {
-        crc ^= polynom;
-      }
-    }
-  }
+  uint16_t crc = crc16Update(CRC16_INIT, data, length);
+
   crc_le[0] = (uint8_t)(crc & 0x00FF);
   crc_le[1] = (uint8_t)(crc >> 8);
 }
@@ -60,7 +108,7 @@ static int _atecc_i2c_probe(struct i2c_client *client,
   uint8_t cmd_read_sn[8] = {0x03, 0x07, 0x02, 0x80, 0x00, 0x00, 0x09, 0xAD};
   uint8_t cmd_wake = 0x00;
 
-  for (i = 0; i < 10; i++) {
+  for (i = 0; i < ATECC_PROBE_TRIES; i++) {
     i2c_master_send(client, &cmd_wake, 1);
     msleep(1);
     if (i2c_master_send(client, cmd_read_sn, 8) == 8) {
@@ -71,6 +119,7 @@ static int _atecc_i2c_probe(struct i2c_client *client,
           memcpy(&_atecc.serialNumber[0], &i2c_response[1], 4);
           memcpy(&_atecc.serialNumber[4], &i2c_response[9], 5);
           _atecc.probed = true;
+          _atecc.client = client;
           ret = 0;
           break;
         }
@@ -82,6 +131,196 @@ static int _atecc_i2c_probe(struct i2c_client *client,
   return ret;
 }
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 0, 0)
+static int _atecc_i2c_remove(struct i2c_client *client) {
+#else
+static void _atecc_i2c_remove(struct i2c_client *client) {
+#endif
+  mutex_lock(&_ateccRng.lock);
+  _atecc.client = NULL;
+  mutex_unlock(&_ateccRng.lock);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 0, 0)
+  return 0;
+#endif
+}
+
+static void _ateccWake(struct i2c_client *client) {
+  uint8_t cmd = 0x00;
+
+  // SDA held low by the address byte, NAKed: not an error
+  i2c_master_send(client, &cmd, 1);
+  usleep_range(1500, 2000);
+}
+
+static void _ateccIdle(struct i2c_client *client) {
+  // idle, unlike sleep, keeps the RNG seed in SRAM
+  uint8_t cmd = 0x02;
+
+  i2c_master_send(client, &cmd, 1);
+}
+
+/*
+ * Random command, to be called awake. Fails with -EIO on the fixed test
+ * pattern returned while the configuration zone is unlocked.
+ */
+static int _ateccRandom(struct i2c_client *client, uint8_t *out) {
+  /*
+   * 0x03 = normal command
+   * 0x07 = total bytes for CRC generation (2 CRC bytes included)
+   * 0x1B = Random
+   * 0x00 = mode: update the seed if needed
+   * 0x00 0x00 = param2, must be 0
+   */
+  uint8_t cmd[8] = {0x03, 0x07, 0x1B, 0x00, 0x00, 0x00};
+  static const uint8_t testPattern[4] = {0xFF, 0xFF, 0x00, 0x00};
+  uint8_t resp[ATECC_RNG_BLOCK_SIZE + 3];
+  uint8_t crc_le[2];
+  int i;
+
+  _getCRC16LittleEndian(5, &cmd[1], &cmd[6]);
+  if (i2c_master_send(client, cmd, 8) != 8) {
+    return -EIO;
+  }
+
+  // NAKs reads until the command is executed
+  for (i = 0; i < ATECC_RANDOM_EXEC_MAX_MS; i++) {
+    usleep_range(1000, 1200);
+    if (i2c_master_recv(client, resp, sizeof(resp)) == sizeof(resp)) {
+      break;
+    }
+  }
+  if (i == ATECC_RANDOM_EXEC_MAX_MS) {
+    return -ETIMEDOUT;
+  }
+
+  if (resp[0] != sizeof(resp)) {
+    // status packet
+    return -EIO;
+  }
+  _getCRC16LittleEndian(sizeof(resp) - 2, resp, crc_le);
+  if (crc_le[0] != resp[sizeof(resp) - 2] ||
+      crc_le[1] != resp[sizeof(resp) - 1]) {
+    return -EIO;
+  }
+  for (i = 0; i < ATECC_RNG_BLOCK_SIZE; i += sizeof(testPattern)) {
+    if (memcmp(&resp[1 + i], testPattern, sizeof(testPattern))) {
+      break;
+    }
+  }
+  if (i == ATECC_RNG_BLOCK_SIZE) {
+    return -EIO;
+  }
+
+  memcpy(out, &resp[1], ATECC_RNG_BLOCK_SIZE);
+  memzero_explicit(resp, sizeof(resp));
+  return 0;
+}
+
+/*
+ * Tops up the buffer with one wake-up for the whole batch. Called
+ * holding _ateccRng.lock.
+ */
+static int _ateccRngFill(void) {
+  struct i2c_client *client = _atecc.client;
+  ktime_t t0;
+  u64 t;
+  int ret = 0;
+
+  if (client == NULL) {
+    return -ENODEV;
+  }
+
+  _ateccWake(client);
+  while (_ateccRng.avail + ATECC_RNG_BLOCK_SIZE <= sizeof(_ateccRng.buf)) {
+    t0 = ktime_get();
+    ret = _ateccRandom(client, &_ateccRng.buf[_ateccRng.avail]);
+    if (ret < 0) {
+      _ateccRng.errCnt++;
+      break;
+    }
+    t = ktime_to_ns(ktime_sub(ktime_get(), t0));
+    _ateccRng.avail += ATECC_RNG_BLOCK_SIZE;
+    _ateccRng.blockCnt++;
+    _ateccRng.blockTimeTot_ns += t;
+    if (t > _ateccRng.blockTimeMax_ns) {
+      _ateccRng.blockTimeMax_ns = t;
+    }
+  }
+  _ateccIdle(client);
+
+  return ret;
+}
+
+static void _ateccRngFillWork(struct work_struct *work) {
+  mutex_lock(&_ateccRng.lock);
+  _ateccRngFill();
+  mutex_unlock(&_ateccRng.lock);
+}
+
+static int _ateccRngRead(struct hwrng *rng, void *data, size_t max,
+                         bool wait) {
+  size_t n;
+  bool low;
+
+  if (wait) {
+    mutex_lock(&_ateccRng.lock);
+  } else if (!mutex_trylock(&_ateccRng.lock)) {
+    return 0;
+  }
+
+  if (_ateccRng.avail == 0 && wait) {
+    _ateccRngFill();
+  }
+  n = min_t(size_t, max, _ateccRng.avail);
+  _ateccRng.avail -= n;
+  memcpy(data, &_ateccRng.buf[_ateccRng.avail], n);
+  memzero_explicit(&_ateccRng.buf[_ateccRng.avail], n);
+  _ateccRng.bytes += n;
+  low = _ateccRng.avail < sizeof(_ateccRng.buf) / 2;
+
+  mutex_unlock(&_ateccRng.lock);
+
+  if (low) {
+    schedule_work(&_ateccRng.fillWork);
+  }
+
+  if (n == 0 && wait) {
+    return -EIO;
+  }
+  return n;
+}
+
+/*
+ * Registers the hwrng once a first batch could be fetched, i.e. the chip
+ * answers Random and its configuration zone is locked.
+ */
+static void _ateccRngRegister(void) {
+  int ret;
+
+  mutex_lock(&_ateccRng.lock);
+  ret = _ateccRngFill();
+  mutex_unlock(&_ateccRng.lock);
+  if (_ateccRng.avail == 0) {
+    pr_warn("atecc: RNG not available (%d), config zone unlocked?\n", ret);
+    return;
+  }
+
+  _ateccRng.hwrng.name = "atecc";
+  _ateccRng.hwrng.read = _ateccRngRead;
+  /*
+   * The output is a DRBG seeded by the chip, not raw noise, and can't
+   * be checked from here: credit little entropy unless told otherwise.
+   * 0 would select the hw_random core's default, which can be 1024.
+   */
+  _ateccRng.hwrng.quality =
+      clamp_t(ushort, rngQuality, 1, ATECC_RNG_QUALITY_MAX);
+  if (hwrng_register(&_ateccRng.hwrng)) {
+    pr_warn("atecc: error registering RNG\n");
+    return;
+  }
+  _ateccRng.registered = true;
+}
+
 const struct of_device_id _atecc_of_match[] = {
     {
         .compatible = "sferalabs,atecc",
@@ -104,17 +343,63 @@ static struct i2c_driver _atecc_i2c_driver = {
             .of_match_table = of_match_ptr(_atecc_of_match),
         },
     .probe = _atecc_i2c_probe,
+    .remove = _atecc_i2c_remove,
     .id_table = _atecc_i2c_id,
 };
 
-ssize_t devAttrAteccSerial_show(struct device *dev,
-                                struct device_attribute *attr, char *buf) {
-  if (!_atecc.probed) {
+/*
+ * Reads and caches the serial number, at most ATECC_PROBE_TRIES attempts
+ * in total. Meant to be called once at init; later calls return the
+ * cached outcome without touching the bus.
+ */
+int ateccProbe(void) {
+  mutex_lock(&_ateccLock);
+  if (_atecc.state == ATECC_STATE_UNKNOWN) {
     i2c_add_driver(&_atecc_i2c_driver);
-    i2c_del_driver(&_atecc_i2c_driver);
-    if (!_atecc.probed) {
-      return -ENODEV;
+    if (_atecc.probed) {
+      // kept bound for the RNG
+      _atecc.driverAdded = true;
+      _ateccRngRegister();
+    } else {
+      i2c_del_driver(&_atecc_i2c_driver);
     }
+    smp_store_release(&_atecc.state, _atecc.probed ? ATECC_STATE_PRESENT
+                                                   : ATECC_STATE_ABSENT);
+  }
+  mutex_unlock(&_ateccLock);
+
+  return _atecc.state == ATECC_STATE_PRESENT ? 0 : -ENODEV;
+}
+
+void ateccFree(void) {
+  mutex_lock(&_ateccLock);
+  if (_ateccRng.registered) {
+    hwrng_unregister(&_ateccRng.hwrng);
+    cancel_work_sync(&_ateccRng.fillWork);
+    _ateccRng.registered = false;
+  }
+  if (_atecc.driverAdded) {
+    i2c_del_driver(&_atecc_i2c_driver);
+    _atecc.driverAdded = false;
+  }
+  // probe again, and register the RNG again, on the next bind
+  _ateccRng.avail = 0;
+  memzero_explicit(_ateccRng.buf, sizeof(_ateccRng.buf));
+  _atecc.probed = false;
+  smp_store_release(&_atecc.state, ATECC_STATE_UNKNOWN);
+  mutex_unlock(&_ateccLock);
+}
+
+ssize_t devAttrAteccSerial_show(struct device *dev,
+                                struct device_attribute *attr, char *buf) {
+  switch (smp_load_acquire(&_atecc.state)) {
+  case ATECC_STATE_PRESENT:
+    break;
+  case ATECC_STATE_ABSENT:
+    return -ENODEV;
+  default:
+    // probe still running
+    return -EAGAIN;
   }
   return sprintf(
       buf, "%02hX %02hX %02hX %02hX %02hX %02hX %02hX %02hX %02hX\n",
@@ -122,3 +407,36 @@ ssize_t devAttrAteccSerial_show(struct device *dev,
       _atecc.serialNumber[3], _atecc.serialNumber[4], _atecc.serialNumber[5],
       _atecc.serialNumber[6], _atecc.serialNumber[7], _atecc.serialNumber[8]);
 }
+
+ssize_t devAttrAteccRngBytes_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf) {
+  return sprintf(buf, "%lu\n", READ_ONCE(_ateccRng.bytes));
+}
+
+ssize_t devAttrAteccRngErrCnt_show(struct device *dev,
+                                   struct device_attribute *attr, char *buf) {
+  return sprintf(buf, "%lu\n", READ_ONCE(_ateccRng.errCnt));
+}
+
+ssize_t devAttrAteccRngBlockAvg_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  u64 tot;
+  unsigned long cnt;
+
+  cnt = READ_ONCE(_ateccRng.blockCnt);
+  tot = READ_ONCE(_ateccRng.blockTimeTot_ns);
+
+  if (cnt == 0) {
+    return sprintf(buf, "0\n");
+  }
+  return sprintf(buf, "%llu\n",
+                 div_u64(div64_ul(tot, cnt), NSEC_PER_USEC));
+}
+
+ssize_t devAttrAteccRngBlockMax_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  return sprintf(buf, "%llu\n",
+                 div_u64(READ_ONCE(_ateccRng.blockTimeMax_ns), NSEC_PER_USEC));
+}
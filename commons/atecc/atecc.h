@@ -3,6 +3,24 @@
 
 #include <linux/device.h>
 
+int ateccProbe(void);
+
+void ateccFree(void);
+
 ssize_t devAttrAteccSerial_show(struct device *dev,
                                 struct device_attribute *attr, char *buf);
+
+ssize_t devAttrAteccRngBytes_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf);
+
+ssize_t devAttrAteccRngErrCnt_show(struct device *dev,
+                                   struct device_attribute *attr, char *buf);
+
+ssize_t devAttrAteccRngBlockAvg_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
+
+ssize_t devAttrAteccRngBlockMax_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
 #endif
@@ -0,0 +1,166 @@
+#include "crc.h"
+
+#include <linux/bitrev.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+
+/*
+ * Lookup tables generated at compile time: each entry is the CRC
+ * register after shifting its index through 8 rounds of the bitwise
+ * algorithm. Arguments are used twice per round, keeping the expansion
+ * small.
+ */
+#define _CRC8_R(c) ((((c) << 1) ^ ((((c) >> 7) & 1) * CRC8_POLY)) & 0xff)
+#define _CRC8_E(i) \
+  _CRC8_R(_CRC8_R(_CRC8_R(_CRC8_R(_CRC8_R(_CRC8_R(_CRC8_R(_CRC8_R(i))))))))
+
+#define _CRC16_R(c) ((((c) << 1) ^ ((((c) >> 15) & 1) * CRC16_POLY)) & 0xffff)
+#define _CRC16_E(i)                                                  \
+  _CRC16_R(_CRC16_R(_CRC16_R(_CRC16_R(                               \
+      _CRC16_R(_CRC16_R(_CRC16_R(_CRC16_R((i) << 8))))))))
+
+#define _CRC_T4(E, n) E(n), E((n) + 1), E((n) + 2), E((n) + 3)
+#define _CRC_T16(E, n) \
+  _CRC_T4(E, n), _CRC_T4(E, (n) + 4), _CRC_T4(E, (n) + 8), _CRC_T4(E, (n) + 12)
+#define _CRC_T64(E, n)                                   \
+  _CRC_T16(E, n), _CRC_T16(E, (n) + 16), _CRC_T16(E, (n) + 32), \
+      _CRC_T16(E, (n) + 48)
+#define _CRC_T256(E)                                             \
+  _CRC_T64(E, 0), _CRC_T64(E, 64), _CRC_T64(E, 128), _CRC_T64(E, 192)
+
+static const uint8_t _crc8Table[256] = {_CRC_T256(_CRC8_E)};
+
+static const uint16_t _crc16Table[256] = {_CRC_T256(_CRC16_E)};
+
+uint8_t crc8Update(uint8_t crc, const uint8_t *data, size_t len) {
+  while (len--) {
+    crc = _crc8Table[crc ^ *data++];
+  }
+  return crc;
+}
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t len) {
+  while (len--) {
+    // data bits are fed LSB first
+    crc = (crc << 8) ^ _crc16Table[(crc >> 8) ^ bitrev8(*data++)];
+  }
+  return crc;
+}
+
+/* Bit by bit reference implementations, as used before the tables */
+
+static uint8_t _crc8Bitwise(uint8_t crc, const uint8_t *data, size_t len) {
+  uint8_t k;
+
+  while (len--) {
+    crc ^= *data++;
+    for (k = 0; k < 8; k++) {
+      crc = crc & 0x80 ? (crc << 1) ^ CRC8_POLY : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static uint16_t _crc16Bitwise(uint16_t crc, const uint8_t *data, size_t len) {
+  uint8_t shift;
+  uint8_t dataBit, crcBit;
+
+  while (len--) {
+    for (shift = 0x01; shift > 0x00; shift <<= 1) {
+      dataBit = (*data & shift) ? 1 : 0;
+      crcBit = crc >> 15;
+      crc <<= 1;
+      if (dataBit != crcBit) {
+        crc ^= CRC16_POLY;
+      }
+    }
+    data++;
+  }
+  return crc;
+}
+
+int crcSelfTest(void) {
+  static const uint8_t check[] = "123456789";
+  // count and params of the ATECC read serial number command
+  static const uint8_t atecc[] = {0x07, 0x02, 0x80, 0x00, 0x00};
+  uint8_t buf[64];
+  size_t i;
+
+  if (crc8Update(CRC8_INIT, check, 9) != 0x20) {
+    return -EINVAL;
+  }
+  if (crc16Update(CRC16_INIT, atecc, sizeof(atecc)) != 0xad09) {
+    return -EINVAL;
+  }
+
+  for (i = 0; i < sizeof(buf); i++) {
+    buf[i] = i * 37 + 11;
+  }
+  for (i = 0; i <= sizeof(buf); i++) {
+    if (crc8Update(CRC8_INIT, buf, i) != _crc8Bitwise(CRC8_INIT, buf, i)) {
+      return -EINVAL;
+    }
+    if (crc16Update(CRC16_INIT, buf, i) !=
+        _crc16Bitwise(CRC16_INIT, buf, i)) {
+      return -EINVAL;
+    }
+  }
+
+  return 0;
+}
+
+#ifdef CRC_BENCHMARK
+#define _CRC_BENCH_LEN 4096
+#define _CRC_BENCH_ROUNDS 64
+
+void crcBenchmark(void) {
+  uint8_t *buf;
+  ktime_t t;
+  u64 t8, t8b, t16, t16b;
+  volatile uint16_t sink = 0;
+  int i;
+
+  buf = kmalloc(_CRC_BENCH_LEN, GFP_KERNEL);
+  if (buf == NULL) {
+    return;
+  }
+  for (i = 0; i < _CRC_BENCH_LEN; i++) {
+    buf[i] = i * 37 + 11;
+  }
+
+  t = ktime_get();
+  for (i = 0; i < _CRC_BENCH_ROUNDS; i++) {
+    sink ^= crc8Update(CRC8_INIT, buf, _CRC_BENCH_LEN);
+  }
+  t8 = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+  t = ktime_get();
+  for (i = 0; i < _CRC_BENCH_ROUNDS; i++) {
+    sink ^= _crc8Bitwise(CRC8_INIT, buf, _CRC_BENCH_LEN);
+  }
+  t8b = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+  t = ktime_get();
+  for (i = 0; i < _CRC_BENCH_ROUNDS; i++) {
+    sink ^= crc16Update(CRC16_INIT, buf, _CRC_BENCH_LEN);
+  }
+  t16 = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+  t = ktime_get();
+  for (i = 0; i < _CRC_BENCH_ROUNDS; i++) {
+    sink ^= _crc16Bitwise(CRC16_INIT, buf, _CRC_BENCH_LEN);
+  }
+  t16b = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+  kfree(buf);
+
+  pr_info("crc benchmark (ps/byte): crc8 table=%llu bitwise=%llu, "
+          "crc16 table=%llu bitwise=%llu\n",
+          t8 * 1000 / (_CRC_BENCH_LEN * _CRC_BENCH_ROUNDS),
+          t8b * 1000 / (_CRC_BENCH_LEN * _CRC_BENCH_ROUNDS),
+          t16 * 1000 / (_CRC_BENCH_LEN * _CRC_BENCH_ROUNDS),
+          t16b * 1000 / (_CRC_BENCH_LEN * _CRC_BENCH_ROUNDS));
+}
+#endif
@@ -0,0 +1,30 @@
+#ifndef _SL_CRC_H
+#define _SL_CRC_H
+
+#include <linux/types.h>
+
+/*
+ * CRC-8 used on the I2C link with the MCU: poly 0x2F, init 0xFF, MSB
+ * first, no final XOR.
+ */
+#define CRC8_POLY 0x2f
+#define CRC8_INIT 0xff
+
+/*
+ * CRC-16 of the ATECC secure element: poly 0x8005, init 0x0000, data
+ * bits LSB first, no final XOR. Sent little endian.
+ */
+#define CRC16_POLY 0x8005
+#define CRC16_INIT 0x0000
+
+uint8_t crc8Update(uint8_t crc, const uint8_t *data, size_t len);
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t len);
+
+int crcSelfTest(void);
+
+#ifdef CRC_BENCHMARK
+void crcBenchmark(void);
+#endif
+
+#endif
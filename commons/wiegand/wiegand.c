@@ -1,49 +1,609 @@
 #include "wiegand.h"
-#include "../utils/utils.h"
 #include <linux/interrupt.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/module.h>
+#include <linux/ktime.h>
+
+#define WIEGAND_DATA_BITS 64
+
+/* mask of the bits in positions from..to, 1 being the first bit received */
+#define WIEGAND_BITS(len, from, to) \
+	((((uint64_t) 1 << ((to) - (from) + 1)) - 1) << ((len) - (to)))
+
+struct WiegandParity {
+	uint64_t mask;
+	bool odd;
+};
+
+struct WiegandFormat {
+	const char *name;
+	int bits;
+	struct WiegandParity parity[4];
+	uint8_t facilityFrom;
+	uint8_t facilityTo;
+	uint8_t cardFrom;
+	uint8_t cardTo;
+};
+
+static const struct WiegandFormat wiegandFormats[WIEGAND_FMT_SIZE] = {
+	[WIEGAND_FMT_H10301] = {
+		.name = "h10301",
+		.bits = 26,
+		.parity = {
+			{ WIEGAND_BITS(26, 1, 13), false },
+			{ WIEGAND_BITS(26, 14, 26), true },
+		},
+		.facilityFrom = 2,
+		.facilityTo = 9,
+		.cardFrom = 10,
+		.cardTo = 25,
+	},
+	[WIEGAND_FMT_H10306] = {
+		.name = "h10306",
+		.bits = 34,
+		.parity = {
+			{ WIEGAND_BITS(34, 1, 17), false },
+			{ WIEGAND_BITS(34, 18, 34), true },
+		},
+		.facilityFrom = 2,
+		.facilityTo = 17,
+		.cardFrom = 18,
+		.cardTo = 33,
+	},
+	[WIEGAND_FMT_C1000] = {
+		.name = "c1000",
+		.bits = 35,
+		.parity = {
+			// bits 2,3,5,6,8,9,...,32,33,35
+			{ 0x36db6db6dULL, true },
+			// bits 2,3,4,6,7,9,10,...,33,34
+			{ 0x3b6db6db6ULL, false },
+			{ WIEGAND_BITS(35, 1, 35), true },
+		},
+		.facilityFrom = 3,
+		.facilityTo = 14,
+		.cardFrom = 15,
+		.cardTo = 34,
+	},
+	[WIEGAND_FMT_H10304] = {
+		.name = "h10304",
+		.bits = 37,
+		.parity = {
+			{ WIEGAND_BITS(37, 1, 19), false },
+			{ WIEGAND_BITS(37, 19, 37), true },
+		},
+		.facilityFrom = 2,
+		.facilityTo = 17,
+		.cardFrom = 18,
+		.cardTo = 36,
+	},
+	[WIEGAND_FMT_H10302] = {
+		.name = "h10302",
+		.bits = 37,
+		.parity = {
+			{ WIEGAND_BITS(37, 1, 19), false },
+			{ WIEGAND_BITS(37, 19, 37), true },
+		},
+		.cardFrom = 2,
+		.cardTo = 36,
+	},
+	[WIEGAND_FMT_KP4] = {
+		.name = "kp4",
+		.bits = 4,
+		.cardFrom = 1,
+		.cardTo = 4,
+	},
+	[WIEGAND_FMT_KP8] = {
+		.name = "kp8",
+		.bits = 8,
+		.parity = {
+			// high nibble is the complement of the low one
+			{ 0x11, true },
+			{ 0x22, true },
+			{ 0x44, true },
+			{ 0x88, true },
+		},
+		.cardFrom = 5,
+		.cardTo = 8,
+	},
+};
+
+struct WiegandTestVector {
+	int format;
+	int bits;
+	uint64_t data;
+	uint32_t facility;
+	uint64_t card;
+};
+
+/* known-good frames, parity bits included */
+static const struct WiegandTestVector wiegandTestVectors[] = {
+	{ WIEGAND_FMT_H10301, 26, 0x246073ULL, 18, 12345 },
+	{ WIEGAND_FMT_C1000, 35, 0x69a5154a4ULL, 1234, 567890 },
+};
+
+/*
+ * Histogram buckets, on time in units of 2^WIEGAND_HIST_SHIFT ns (~1 usec):
+ * 1 unit wide up to 4 units, then 4 buckets per octave, i.e. 4, 5, 6, 7, 8,
+ * 10, 12, 14, 16, 20, ... units. The last bucket collects everything above
+ * 114688 units (~117 msec).
+ */
+static int wiegandHistBucket(u64 nsec) {
+	u64 units;
+	int msb;
+	int b;
+
+	units = nsec >> WIEGAND_HIST_SHIFT;
+	if (units < 4) {
+		return units;
+	}
+	msb = ilog2(units);
+	b = (msb - 1) * 4 + ((units >> (msb - 2)) & 3);
+	return min(b, WIEGAND_HIST_BUCKETS - 1);
+}
+
+static u64 wiegandHistBucketMin(int b) {
+	if (b < 4) {
+		return (u64) b << WIEGAND_HIST_SHIFT;
+	}
+	return ((4ull + (b & 3)) << (b / 4 - 1)) << WIEGAND_HIST_SHIFT;
+}
+
+static uint64_t wiegandField(const struct WiegandFrame *frame, int from,
+		int to) {
+	if (from == 0) {
+		return 0;
+	}
+	return (frame->data >> (frame->bits - to))
+			& ((((uint64_t) 1) << (to - from + 1)) - 1);
+}
+
+/*
+ * Looks for an enabled format matching length and parity of the frame and,
+ * if found, fills in its decoded fields.
+ */
+static bool wiegandDecode(uint32_t formats, struct WiegandFrame *frame) {
+	const struct WiegandFormat *fmt;
+	bool valid;
+	int f, i;
+
+	for (f = WIEGAND_FMT_NONE + 1; f < WIEGAND_FMT_SIZE; f++) {
+		fmt = &wiegandFormats[f];
+		if ((formats & BIT(f)) == 0 || fmt->bits != frame->bits) {
+			continue;
+		}
+
+		valid = true;
+		for (i = 0; i < ARRAY_SIZE(fmt->parity); i++) {
+			if (fmt->parity[i].mask == 0) {
+				break;
+			}
+			if ((hweight64(frame->data & fmt->parity[i].mask) & 1)
+					!= fmt->parity[i].odd) {
+				valid = false;
+				break;
+			}
+		}
+
+		if (valid) {
+			frame->format = f;
+			frame->facility = wiegandField(frame, fmt->facilityFrom,
+					fmt->facilityTo);
+			frame->card = wiegandField(frame, fmt->cardFrom, fmt->cardTo);
+			return true;
+		}
+	}
+
+	return false;
+}
 
-#define WIEGAND_MAX_BITS 64
+/*
+ * Closes the frame being received, if any, and queues it. When formats are
+ * enabled, frames not matching any of them are counted and dropped.
+ * Must be called with w->lock held. Returns true if a frame was queued.
+ */
+static bool wiegandFrameEnd(struct WiegandBean *w) {
+	struct WiegandFrame frame;
 
-int wCount = 0;
+	if (w->bitCount == 0) {
+		return false;
+	}
+
+	// CLOCK_MONOTONIC, as the frame timer; was CLOCK_MONOTONIC_RAW
+	frame.ts = ktime_to_us(w->lastBitTime);
+	frame.data = w->data;
+	memcpy(frame.raw, w->raw, sizeof(frame.raw));
+	frame.bits = w->bitCount;
+	frame.noise = w->frameNoise;
+	frame.card = 0;
+	frame.facility = 0;
+	frame.format = WIEGAND_FMT_NONE;
+
+	w->data = 0;
+	memset(w->raw, 0, sizeof(w->raw));
+	w->bitCount = 0;
+	w->frameNoise = 0;
+
+	if (w->formats != 0) {
+		if (!wiegandDecode(w->formats, &frame)) {
+			w->invalidCnt++;
+			return false;
+		}
+		w->lastCard = frame;
+	}
+
+	w->lastFrame = frame;
+
+	if (!kfifo_put(&w->frames, frame)) {
+		pr_warn_ratelimited("wiegand w%c: frames queue full, frame dropped\n",
+				w->id);
+	}
+
+	return true;
+}
+
+static void wiegandFrameNotify(struct WiegandBean *w) {
+	wake_up_interruptible(&w->readQueue);
+	if (w->notifKn != NULL) {
+		sysfs_notify_dirent(w->notifKn);
+	}
+	if (w->formats != 0 && w->notifCardKn != NULL) {
+		sysfs_notify_dirent(w->notifCardKn);
+	}
+}
 
 static enum hrtimer_restart wiegandTimerHandler(struct hrtimer *tmr) {
 	struct WiegandBean *w;
+	unsigned long flags;
+	bool queued;
+
 	w = container_of(tmr, struct WiegandBean, timer);
-	if (w->notifKn != NULL) {
-		sysfs_notify_dirent(w->notifKn);
+
+	spin_lock_irqsave(&w->lock, flags);
+	if (w->bitCount != 0 && ktime_before(ktime_get(), w->frameEnd)) {
+		// more bits received since the timer was armed
+		hrtimer_set_expires(tmr, w->frameEnd);
+		spin_unlock_irqrestore(&w->lock, flags);
+		return HRTIMER_RESTART;
+	}
+	w->timerArmed = false;
+	queued = wiegandFrameEnd(w);
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	if (queued) {
+		wiegandFrameNotify(w);
 	}
 	return HRTIMER_NORESTART;
 }
 
-void wiegandInit(struct WiegandBean *w) {
+/*
+ * Pulse width and interval of transmitted frames are the middle of the
+ * receiver ranges, the gap between frames twice the max interval so that
+ * the receiving end can tell them apart.
+ */
+static void wiegandTxTiming(struct WiegandBean *w) {
+	u64 itvl;
+
+	w->txWidth_nsec = (w->pulseWidthMin_nsec + w->pulseWidthMax_nsec) >> 1;
+	itvl = (w->pulseIntervalMin_nsec + w->pulseIntervalMax_nsec) >> 1;
+	w->txSpace_nsec = itvl > w->txWidth_nsec ?
+			itvl - w->txWidth_nsec : w->txWidth_nsec;
+	w->txGap_nsec = w->pulseIntervalMax_nsec << 1;
+}
+
+static void wiegandTxNotify(struct WiegandBean *w) {
+	wake_up_interruptible(&w->writeQueue);
+	if (w->notifTxCntKn != NULL) {
+		sysfs_notify_dirent(w->notifTxCntKn);
+	}
+}
+
+/*
+ * Transmitter state machine. Lines idle high, each bit is a low pulse on D0
+ * (0) or D1 (1). Expiries are advanced from the previous one, not from the
+ * handler run time, so that latency does not accumulate along the frame.
+ */
+static enum hrtimer_restart wiegandTxTimerHandler(struct hrtimer *tmr) {
+	struct WiegandBean *w;
+	unsigned long flags;
+	u64 next;
+	int bit;
+
+	w = container_of(tmr, struct WiegandBean, txTimer);
+
+	switch (w->txState) {
+	case WIEGAND_TX_PULSE:
+		gpioSetVal(w->txGpio, 1);
+		w->txBit++;
+		if (w->txBit < w->txFrame.bits) {
+			w->txState = WIEGAND_TX_SPACE;
+			next = w->txSpace_nsec;
+		} else {
+			w->txCnt++;
+			w->txState = WIEGAND_TX_GAP;
+			next = w->txGap_nsec;
+			wiegandTxNotify(w);
+		}
+		break;
+
+	case WIEGAND_TX_GAP:
+		spin_lock_irqsave(&w->lock, flags);
+		if (!kfifo_get(&w->txFrames, &w->txFrame)) {
+			w->txBusy = false;
+			spin_unlock_irqrestore(&w->lock, flags);
+			wake_up_interruptible(&w->writeQueue);
+			return HRTIMER_NORESTART;
+		}
+		spin_unlock_irqrestore(&w->lock, flags);
+		// room in the queue
+		wake_up_interruptible(&w->writeQueue);
+		w->txBit = 0;
+		wiegandTxTiming(w);
+		fallthrough;
+
+	case WIEGAND_TX_SPACE:
+	default:
+		bit = (w->txFrame.raw[w->txBit >> 3] >> (7 - (w->txBit & 7))) & 1;
+		w->txGpio = bit ? w->d1.gpio : w->d0.gpio;
+		gpioSetVal(w->txGpio, 0);
+		w->txState = WIEGAND_TX_PULSE;
+		next = w->txWidth_nsec;
+		break;
+	}
+
+	hrtimer_add_expires_ns(tmr, next);
+	return HRTIMER_RESTART;
+}
+
+static void wiegandTxStart(struct WiegandBean *w) {
+	unsigned long flags;
+
+	spin_lock_irqsave(&w->lock, flags);
+	if (w->txEnabled && !w->txBusy && !kfifo_is_empty(&w->txFrames)) {
+		w->txBusy = true;
+		w->txState = WIEGAND_TX_GAP;
+		hrtimer_start(&w->txTimer, ktime_get(), HRTIMER_MODE_ABS);
+	}
+	spin_unlock_irqrestore(&w->lock, flags);
+}
+
+/*
+ * Queues a frame for transmission. Must be called with w->writeLock held.
+ */
+static int wiegandTxQueue(struct WiegandBean *w,
+		const struct WiegandTxFrame *frame) {
+	if (frame->bits < 1 || frame->bits > WIEGAND_MAX_BITS) {
+		return -EINVAL;
+	}
+	if (!kfifo_put(&w->txFrames, *frame)) {
+		return -EAGAIN;
+	}
+	return 0;
+}
+
+static ssize_t wiegandDevRead(struct file *file, char __user *buf,
+		size_t count, loff_t *ppos) {
+	struct WiegandBean *w;
+	unsigned int copied;
+	int ret;
+
+	w = container_of(file->private_data, struct WiegandBean, miscDev);
+
+	if (count < sizeof(struct WiegandFrame)) {
+		return -EINVAL;
+	}
+
+	if (mutex_lock_interruptible(&w->readLock)) {
+		return -ERESTARTSYS;
+	}
+
+	while (kfifo_is_empty(&w->frames)) {
+		mutex_unlock(&w->readLock);
+		if (file->f_flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		ret = wait_event_interruptible(w->readQueue,
+				!kfifo_is_empty(&w->frames));
+		if (ret) {
+			return ret;
+		}
+		if (mutex_lock_interruptible(&w->readLock)) {
+			return -ERESTARTSYS;
+		}
+	}
+
+	ret = kfifo_to_user(&w->frames, buf, count, &copied);
+
+	mutex_unlock(&w->readLock);
+
+	if (ret) {
+		return ret;
+	}
+	return copied;
+}
+
+static ssize_t wiegandDevWrite(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos) {
+	struct WiegandBean *w;
+	struct WiegandTxFrame frame;
+	size_t written = 0;
+	int ret = 0;
+
+	w = container_of(file->private_data, struct WiegandBean, miscDev);
+
+	if (count < sizeof(struct WiegandTxFrame)) {
+		return -EINVAL;
+	}
+
+	if (!w->txEnabled) {
+		return -ENODEV;
+	}
+
+	if (mutex_lock_interruptible(&w->writeLock)) {
+		return -ERESTARTSYS;
+	}
+
+	while (kfifo_is_full(&w->txFrames)) {
+		mutex_unlock(&w->writeLock);
+		if (file->f_flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		ret = wait_event_interruptible(w->writeQueue,
+				!kfifo_is_full(&w->txFrames) || !w->txEnabled);
+		if (ret) {
+			return ret;
+		}
+		if (!w->txEnabled) {
+			return -ENODEV;
+		}
+		if (mutex_lock_interruptible(&w->writeLock)) {
+			return -ERESTARTSYS;
+		}
+	}
+
+	while (count - written >= sizeof(frame)) {
+		if (copy_from_user(&frame, buf + written, sizeof(frame))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = wiegandTxQueue(w, &frame);
+		if (ret) {
+			break;
+		}
+		written += sizeof(frame);
+	}
+
+	mutex_unlock(&w->writeLock);
+
+	wiegandTxStart(w);
+
+	if (written > 0) {
+		return written;
+	}
+	return ret;
+}
+
+static __poll_t wiegandDevPoll(struct file *file, poll_table *wait) {
+	struct WiegandBean *w;
+	__poll_t mask = 0;
+
+	w = container_of(file->private_data, struct WiegandBean, miscDev);
+
+	poll_wait(file, &w->readQueue, wait);
+	poll_wait(file, &w->writeQueue, wait);
+
+	if (!kfifo_is_empty(&w->frames)) {
+		mask |= EPOLLIN | EPOLLRDNORM;
+	}
+	if (w->txEnabled && !kfifo_is_full(&w->txFrames)) {
+		mask |= EPOLLOUT | EPOLLWRNORM;
+	}
+	return mask;
+}
+
+/*
+ * Waits for all the queued frames to be transmitted.
+ */
+static int wiegandDevFsync(struct file *file, loff_t start, loff_t end,
+		int datasync) {
+	struct WiegandBean *w;
+
+	w = container_of(file->private_data, struct WiegandBean, miscDev);
+
+	return wait_event_interruptible(w->writeQueue, !w->txBusy);
+}
+
+static const struct file_operations wiegandDevFops = {
+	.owner = THIS_MODULE,
+	.read = wiegandDevRead,
+	.write = wiegandDevWrite,
+	.poll = wiegandDevPoll,
+	.fsync = wiegandDevFsync,
+	.llseek = noop_llseek,
+};
+
+int wiegandInit(struct WiegandBean *w) {
+	int res;
+
 	w->d0.irqRequested = false;
 	w->d1.irqRequested = false;
 	w->enabled = false;
-	w->pulseWidthMin_usec = 10;
-	w->pulseWidthMax_usec = 150;
-	w->pulseIntervalMin_usec = 1200;
-	w->pulseIntervalMax_usec = 2700;
+	w->pulseWidthMin_nsec = 10 * NSEC_PER_USEC;
+	w->pulseWidthMax_nsec = 150 * NSEC_PER_USEC;
+	w->pulseIntervalMin_nsec = 1200 * NSEC_PER_USEC;
+	w->pulseIntervalMax_nsec = 2700 * NSEC_PER_USEC;
+	w->timerArmed = false;
+	w->irqMax_nsec = 0;
 	w->noise = 0;
-	w->id = '0' + (++wCount);
+	w->frameNoise = 0;
+	w->formats = 0;
+	w->invalidCnt = 0;
+	w->maxBits = WIEGAND_MAX_BITS;
+	w->txEnabled = false;
+	w->txBusy = false;
+	w->txCnt = 0;
+	spin_lock_init(&w->lock);
+	mutex_init(&w->readLock);
+	mutex_init(&w->writeLock);
+	init_waitqueue_head(&w->readQueue);
+	init_waitqueue_head(&w->writeQueue);
+	INIT_KFIFO(w->frames);
+	INIT_KFIFO(w->txFrames);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
 	hrtimer_setup(&w->timer, wiegandTimerHandler, CLOCK_MONOTONIC,
-				  HRTIMER_MODE_REL);
+				  HRTIMER_MODE_ABS);
+	hrtimer_setup(&w->txTimer, wiegandTxTimerHandler, CLOCK_MONOTONIC,
+				  HRTIMER_MODE_ABS);
 #else
-	hrtimer_init(&w->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hrtimer_init(&w->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
 	w->timer.function = &wiegandTimerHandler;
+	hrtimer_init(&w->txTimer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	w->txTimer.function = &wiegandTxTimerHandler;
 #endif
+
+	w->stats = alloc_percpu(struct WiegandStats);
+	if (w->stats == NULL) {
+		return -ENOMEM;
+	}
+
+	snprintf(w->devName, sizeof(w->devName), "%s_w%c", KBUILD_MODNAME, w->id);
+	w->miscDev.minor = MISC_DYNAMIC_MINOR;
+	w->miscDev.name = w->devName;
+	w->miscDev.fops = &wiegandDevFops;
+	w->miscDev.mode = 0660;
+	res = misc_register(&w->miscDev);
+	if (res) {
+		pr_err("error registering wiegand device %s\n", w->devName);
+		return res;
+	}
+	w->miscDevRegistered = true;
+
+	return 0;
+}
+
+void wiegandFree(struct WiegandBean *w) {
+	if (w->miscDevRegistered) {
+		misc_deregister(&w->miscDev);
+		w->miscDevRegistered = false;
+	}
+	if (w->stats != NULL) {
+		free_percpu(w->stats);
+		w->stats = NULL;
+	}
 }
 
 static void wiegandReset(struct WiegandBean *w) {
 	w->enabled = true;
 	w->data = 0;
+	memset(w->raw, 0, sizeof(w->raw));
 	w->bitCount = 0;
 	w->activeLine = NULL;
 	w->d0.wasLow = false;
 	w->d1.wasLow = false;
 }
 
-void wiegandDisable(struct WiegandBean *w) {
+static void wiegandRxDisable(struct WiegandBean *w) {
 	if (w->enabled) {
 		hrtimer_cancel(&w->timer);
 
@@ -66,13 +626,54 @@ void wiegandDisable(struct WiegandBean *w) {
 	}
 }
 
+static void wiegandTxDisable(struct WiegandBean *w) {
+	unsigned long flags;
+
+	if (w->txEnabled) {
+		spin_lock_irqsave(&w->lock, flags);
+		w->txEnabled = false;
+		spin_unlock_irqrestore(&w->lock, flags);
+
+		hrtimer_cancel(&w->txTimer);
+
+		mutex_lock(&w->writeLock);
+		kfifo_reset(&w->txFrames);
+		w->txBusy = false;
+		mutex_unlock(&w->writeLock);
+		wake_up_interruptible(&w->writeQueue);
+
+		gpioSetVal(w->d0.gpio, 1);
+		gpioSetVal(w->d1.gpio, 1);
+		gpioFree(w->d0.gpio);
+		gpioFree(w->d1.gpio);
+
+		w->d0.gpio->owner = NULL;
+		w->d1.gpio->owner = NULL;
+	}
+}
+
+void wiegandDisable(struct WiegandBean *w) {
+	wiegandRxDisable(w);
+	wiegandTxDisable(w);
+}
+
+/*
+ * Runs on both edges of D0 and D1. Timing is kept in ktime_t: no divisions
+ * on this path. The frame-end timer is armed at the first bit of a frame and
+ * each further bit just moves w->frameEnd, the timer handler re-arms itself
+ * if it fires before it.
+ */
 static irqreturn_t wiegandDataIrqHandler(int irq, void *dev) {
 	bool isLow;
-	struct timespec64 now;
-	unsigned long long diff;
+	bool queued = false;
+	ktime_t now;
+	u64 diff;
+	unsigned long flags;
 	struct WiegandBean *w;
 	struct WiegandLine *l;
 
+	now = ktime_get();
+
 	w = (struct WiegandBean*) dev;
 	l = NULL;
 
@@ -90,31 +691,36 @@ static irqreturn_t wiegandDataIrqHandler(int irq, void *dev) {
 
 	isLow = gpioGetVal(l->gpio) == 0;
 
-	ktime_get_raw_ts64(&now);
+	spin_lock_irqsave(&w->lock, flags);
 
 	if (l->wasLow == isLow) {
 		// got the interrupt but didn't change state. Maybe a fast pulse
 		if (w->noise == 0) {
 			w->noise = 10;
 		}
-		return IRQ_HANDLED;
+		if (w->frameNoise == 0) {
+			w->frameNoise = 10;
+		}
+		this_cpu_inc(w->stats->noise[10 - WIEGAND_NOISE_MIN]);
+		goto out;
 	}
 
 	l->wasLow = isLow;
 
 	if (isLow) {
 		if (w->bitCount != 0) {
-			diff = diff_usec((struct timespec64*) &(w->lastBitTs), &now);
+			diff = ktime_to_ns(ktime_sub(now, w->lastBitTime));
+			this_cpu_inc(w->stats->pulseInterval[wiegandHistBucket(diff)]);
 
-			if (diff < w->pulseIntervalMin_usec) {
+			if (diff < w->pulseIntervalMin_nsec) {
 				// pulse too early
 				w->noise = 11;
 				goto noise;
 			}
 
-			if (diff > w->pulseIntervalMax_usec) {
-				w->data = 0;
-				w->bitCount = 0;
+			if (diff > w->pulseIntervalMax_nsec) {
+				// the frame timer is late, close the frame here
+				queued = wiegandFrameEnd(w);
 			}
 		}
 
@@ -125,9 +731,7 @@ static irqreturn_t wiegandDataIrqHandler(int irq, void *dev) {
 		}
 
 		w->activeLine = l;
-
-		w->lastBitTs.tv_sec = now.tv_sec;
-		w->lastBitTs.tv_nsec = now.tv_nsec;
+		w->lastBitTime = now;
 
 	} else {
 		if (w->activeLine != l) {
@@ -138,38 +742,64 @@ static irqreturn_t wiegandDataIrqHandler(int irq, void *dev) {
 
 		w->activeLine = NULL;
 
-		if (w->bitCount >= WIEGAND_MAX_BITS) {
-			return IRQ_HANDLED;
+		if (w->bitCount >= w->maxBits) {
+			// bit ignored, keep the frame open until it ends
+			w->frameEnd = ktime_add_ns(w->lastBitTime,
+					w->pulseIntervalMax_nsec);
+			goto out;
 		}
 
-		diff = diff_usec((struct timespec64*) &(w->lastBitTs), &now);
-		if (diff < w->pulseWidthMin_usec) {
+		diff = ktime_to_ns(ktime_sub(now, w->lastBitTime));
+		this_cpu_inc(w->stats->pulseWidth[wiegandHistBucket(diff)]);
+		if (diff < w->pulseWidthMin_nsec) {
 			// pulse too short
 			w->noise = 14;
 			goto noise;
 		}
-		if (diff > w->pulseWidthMax_usec) {
+		if (diff > w->pulseWidthMax_nsec) {
 			// pulse too long
 			w->noise = 15;
 			goto noise;
 		}
 
-		w->data <<= 1;
+		// first 64 bits as integer, all of them in the bit buffer
+		if (w->bitCount < WIEGAND_DATA_BITS) {
+			w->data <<= 1;
+		}
 		if (l == &w->d1) {
-			w->data |= 1;
+			if (w->bitCount < WIEGAND_DATA_BITS) {
+				w->data |= 1;
+			}
+			w->raw[w->bitCount >> 3] |= 0x80 >> (w->bitCount & 7);
 		}
 		w->bitCount++;
 
-		hrtimer_cancel(&w->timer);
-		hrtimer_start(&w->timer,
-				ktime_set(0, (w->pulseIntervalMax_usec - diff) * 1000),
-				HRTIMER_MODE_REL);
+		w->frameEnd = ktime_add_ns(w->lastBitTime, w->pulseIntervalMax_nsec);
+		if (!w->timerArmed) {
+			w->timerArmed = true;
+			hrtimer_start(&w->timer, w->frameEnd, HRTIMER_MODE_ABS);
+		}
 	}
 
-	return IRQ_HANDLED;
+	goto out;
 
 	noise:
+	this_cpu_inc(w->stats->noise[w->noise - WIEGAND_NOISE_MIN]);
+	w->frameNoise = w->noise;
 	wiegandReset(w);
+
+	out:
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	if (queued) {
+		wiegandFrameNotify(w);
+	}
+
+	diff = ktime_to_ns(ktime_sub(ktime_get(), now));
+	if (diff > w->irqMax_nsec) {
+		w->irqMax_nsec = diff;
+	}
+
 	return IRQ_HANDLED;
 }
 
@@ -187,6 +817,7 @@ ssize_t devAttrWiegandEnabled_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count) {
 	struct WiegandBean *w;
 	bool enable;
+	unsigned long flags;
 	int result = 0;
 
 	w = wiegandGetBean(dev, attr);
@@ -254,10 +885,14 @@ ssize_t devAttrWiegandEnabled_store(struct device *dev,
 	}
 
 	if (enable) {
+		spin_lock_irqsave(&w->lock, flags);
 		w->noise = 0;
+		w->frameNoise = 0;
+		w->timerArmed = false;
 		wiegandReset(w);
+		spin_unlock_irqrestore(&w->lock, flags);
 	} else {
-		wiegandDisable(w);
+		wiegandRxDisable(w);
 	}
 
 	if (result) {
@@ -266,11 +901,138 @@ ssize_t devAttrWiegandEnabled_store(struct device *dev,
 	return count;
 }
 
+ssize_t devAttrWiegandTxEnabled_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+	return sprintf(buf, w->txEnabled ? "1\n" : "0\n");
+}
+
+ssize_t devAttrWiegandTxEnabled_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	bool enable;
+	unsigned long flags;
+	int result = 0;
+
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (buf[0] == '0') {
+		enable = false;
+	} else if (buf[0] == '1') {
+		enable = true;
+	} else {
+		return -EINVAL;
+	}
+
+	if (enable && !w->txEnabled) {
+		if (w->d0.gpio->owner != NULL || w->d1.gpio->owner != NULL) {
+			return -EBUSY;
+		}
+		w->d0.gpio->owner = w;
+		w->d1.gpio->owner = w;
+
+		// lines idle high
+		w->d0.gpio->flags = GPIOD_OUT_HIGH;
+		w->d1.gpio->flags = GPIOD_OUT_HIGH;
+
+		result = gpioInit(w->d0.gpio);
+		if (!result) {
+			result = gpioInit(w->d1.gpio);
+		}
+
+		if (result) {
+			pr_err("error setting up wiegand GPIOs\n");
+			gpioFree(w->d0.gpio);
+			gpioFree(w->d1.gpio);
+			w->d0.gpio->owner = NULL;
+			w->d1.gpio->owner = NULL;
+			return result;
+		}
+
+		spin_lock_irqsave(&w->lock, flags);
+		w->txEnabled = true;
+		spin_unlock_irqrestore(&w->lock, flags);
+	} else if (!enable) {
+		wiegandTxDisable(w);
+	}
+
+	return count;
+}
+
+ssize_t devAttrWiegandTx_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	struct WiegandTxFrame frame;
+	char hex[WIEGAND_MAX_BYTES * 2 + 1];
+	size_t len;
+	int ret;
+
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (!w->txEnabled) {
+		return -ENODEV;
+	}
+
+	if (sscanf(buf, "%d %64s", &frame.bits, hex) != 2) {
+		return -EINVAL;
+	}
+
+	len = strlen(hex);
+	if (frame.bits < 1 || frame.bits > WIEGAND_MAX_BITS
+			|| len != DIV_ROUND_UP(frame.bits, 8) * 2) {
+		return -EINVAL;
+	}
+
+	memset(frame.raw, 0, sizeof(frame.raw));
+	if (hex2bin(frame.raw, hex, len / 2)) {
+		return -EINVAL;
+	}
+
+	if (mutex_lock_interruptible(&w->writeLock)) {
+		return -ERESTARTSYS;
+	}
+	ret = wiegandTxQueue(w, &frame);
+	mutex_unlock(&w->writeLock);
+
+	if (ret) {
+		return ret;
+	}
+
+	wiegandTxStart(w);
+
+	return count;
+}
+
+ssize_t devAttrWiegandTxCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (w->notifTxCntKn == NULL) {
+		w->notifTxCntKn = sysfs_get_dirent(dev->kobj.sd, attr->attr.name);
+	}
+
+	return sprintf(buf, "%lu\n", w->txCnt);
+}
+
 ssize_t devAttrWiegandData_show(struct device *dev,
 		struct device_attribute *attr, char *buf) {
-	struct timespec64 now;
-	unsigned long long diff;
 	struct WiegandBean *w;
+	struct WiegandFrame frame;
+	unsigned long flags;
 	w = wiegandGetBean(dev, attr);
 	if (w == NULL) {
 		return -EFAULT;
@@ -284,14 +1046,184 @@ ssize_t devAttrWiegandData_show(struct device *dev,
 		w->notifKn = sysfs_get_dirent(dev->kobj.sd, attr->attr.name);
 	}
 
-	ktime_get_raw_ts64(&now);
-	diff = diff_usec((struct timespec64*) &(w->lastBitTs), &now);
-	if (diff <= w->pulseIntervalMax_usec) {
-		return -EBUSY;
+	spin_lock_irqsave(&w->lock, flags);
+	frame = w->lastFrame;
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	return sprintf(buf, "%llu %d %llu\n", frame.ts,
+			min(frame.bits, WIEGAND_DATA_BITS), frame.data);
+}
+
+ssize_t devAttrWiegandDataHex_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	struct WiegandFrame frame;
+	unsigned long flags;
+	char *end;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (!w->enabled) {
+		return -ENODEV;
+	}
+
+	spin_lock_irqsave(&w->lock, flags);
+	frame = w->lastFrame;
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	end = buf + sprintf(buf, "%llu %d ", frame.ts, frame.bits);
+	end = bin2hex(end, frame.raw, DIV_ROUND_UP(frame.bits, 8));
+	*end++ = '\n';
+
+	return end - buf;
+}
+
+ssize_t devAttrWiegandMaxBits_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	return sprintf(buf, "%d\n", w->maxBits);
+}
+
+ssize_t devAttrWiegandMaxBits_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+	unsigned long flags;
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (val < 1 || val > WIEGAND_MAX_BITS) {
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&w->lock, flags);
+	w->maxBits = val;
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	return count;
+}
+
+ssize_t devAttrWiegandCard_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	struct WiegandFrame frame;
+	unsigned long flags;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (!w->enabled) {
+		return -ENODEV;
+	}
+
+	if (w->notifCardKn == NULL) {
+		w->notifCardKn = sysfs_get_dirent(dev->kobj.sd, attr->attr.name);
+	}
+
+	spin_lock_irqsave(&w->lock, flags);
+	frame = w->lastCard;
+	spin_unlock_irqrestore(&w->lock, flags);
+
+	return sprintf(buf, "%llu %s %u %llu\n", frame.ts,
+			frame.format == WIEGAND_FMT_NONE ?
+					"none" : wiegandFormats[frame.format].name,
+			frame.facility, frame.card);
+}
+
+ssize_t devAttrWiegandFormats_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	int f;
+	ssize_t len = 0;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	for (f = WIEGAND_FMT_NONE + 1; f < WIEGAND_FMT_SIZE; f++) {
+		if (w->formats & BIT(f)) {
+			len += sprintf(buf + len, len == 0 ? "%s" : " %s",
+					wiegandFormats[f].name);
+		}
+	}
+
+	if (len == 0) {
+		len = sprintf(buf, "none");
+	}
+
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+
+ssize_t devAttrWiegandFormats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	uint32_t formats = 0;
+	const char *tok;
+	size_t tokLen;
+	int f;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	tok = buf;
+	while (tok < buf + count) {
+		tok += strspn(tok, " ,\n");
+		tokLen = strcspn(tok, " ,\n");
+		if (tokLen == 0) {
+			break;
+		}
+
+		if (tokLen == 4 && strncmp(tok, "none", 4) == 0) {
+			formats = 0;
+		} else {
+			for (f = WIEGAND_FMT_NONE + 1; f < WIEGAND_FMT_SIZE; f++) {
+				if (strlen(wiegandFormats[f].name) == tokLen
+						&& strncmp(tok, wiegandFormats[f].name, tokLen) == 0) {
+					formats |= BIT(f);
+					break;
+				}
+			}
+			if (f == WIEGAND_FMT_SIZE) {
+				return -EINVAL;
+			}
+		}
+
+		tok += tokLen;
+	}
+
+	w->formats = formats;
+
+	return count;
+}
+
+ssize_t devAttrWiegandInvalidCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
 	}
 
-	return sprintf(buf, "%llu %d %llu\n", to_usec(&w->lastBitTs), w->bitCount,
-			w->data);
+	return sprintf(buf, "%lu\n", w->invalidCnt);
 }
 
 ssize_t devAttrWiegandNoise_show(struct device *dev,
@@ -309,6 +1241,170 @@ ssize_t devAttrWiegandNoise_show(struct device *dev,
 	return sprintf(buf, "%d\n", noise);
 }
 
+ssize_t devAttrWiegandNoiseCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	struct WiegandStats *st;
+	unsigned long cnt;
+	ssize_t len = 0;
+	int cpu, i;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	for (i = 0; i <= WIEGAND_NOISE_MAX - WIEGAND_NOISE_MIN; i++) {
+		cnt = 0;
+		for_each_possible_cpu(cpu) {
+			st = per_cpu_ptr(w->stats, cpu);
+			cnt += st->noise[i];
+		}
+		len += sprintf(buf + len, i == 0 ? "%lu" : " %lu", cnt);
+	}
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+
+ssize_t devAttrWiegandNoiseCnt_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	struct WiegandStats *st;
+	int cpu;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(w->stats, cpu);
+		memset(st->noise, 0, sizeof(st->noise));
+	}
+
+	return count;
+}
+
+static ssize_t wiegandHistShow(struct WiegandBean *w, size_t offset,
+		char *buf) {
+	unsigned long *hist;
+	unsigned long cnt;
+	ssize_t len = 0;
+	int cpu, b;
+
+	for (b = 0; b < WIEGAND_HIST_BUCKETS; b++) {
+		cnt = 0;
+		for_each_possible_cpu(cpu) {
+			hist = (void *) per_cpu_ptr(w->stats, cpu) + offset;
+			cnt += hist[b];
+		}
+		if (cnt > 0) {
+			len += sprintf(buf + len, "%llu %lu\n", wiegandHistBucketMin(b),
+					cnt);
+		}
+	}
+
+	return len;
+}
+
+static void wiegandHistReset(struct WiegandBean *w, size_t offset) {
+	unsigned long *hist;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		hist = (void *) per_cpu_ptr(w->stats, cpu) + offset;
+		memset(hist, 0, WIEGAND_HIST_BUCKETS * sizeof(*hist));
+	}
+}
+
+ssize_t devAttrWiegandPulseWidthHist_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	return wiegandHistShow(w, offsetof(struct WiegandStats, pulseWidth), buf);
+}
+
+ssize_t devAttrWiegandPulseWidthHist_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+
+	wiegandHistReset(w, offsetof(struct WiegandStats, pulseWidth));
+
+	return count;
+}
+
+ssize_t devAttrWiegandPulseIntervalHist_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	return wiegandHistShow(w, offsetof(struct WiegandStats, pulseInterval),
+			buf);
+}
+
+ssize_t devAttrWiegandPulseIntervalHist_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+
+	wiegandHistReset(w, offsetof(struct WiegandStats, pulseInterval));
+
+	return count;
+}
+
+ssize_t devAttrWiegandIrqMax_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	return sprintf(buf, "%llu\n", w->irqMax_nsec);
+}
+
+ssize_t devAttrWiegandIrqMax_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct WiegandBean *w;
+	w = wiegandGetBean(dev, attr);
+	if (w == NULL) {
+		return -EFAULT;
+	}
+
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+
+	w->irqMax_nsec = 0;
+
+	return count;
+}
+
 ssize_t devAttrWiegandPulseIntervalMin_show(struct device *dev,
 		struct device_attribute *attr, char *buf) {
 	struct WiegandBean *w;
@@ -317,7 +1413,7 @@ ssize_t devAttrWiegandPulseIntervalMin_show(struct device *dev,
 		return -EFAULT;
 	}
 
-	return sprintf(buf, "%lu\n", w->pulseIntervalMin_usec);
+	return sprintf(buf, "%llu\n", div_u64(w->pulseIntervalMin_nsec, NSEC_PER_USEC));
 }
 
 ssize_t devAttrWiegandPulseIntervalMin_store(struct device *dev,
@@ -335,7 +1431,7 @@ ssize_t devAttrWiegandPulseIntervalMin_store(struct device *dev,
 		return ret;
 	}
 
-	w->pulseIntervalMin_usec = val;
+	w->pulseIntervalMin_nsec = (u64) val * NSEC_PER_USEC;
 
 	return count;
 }
@@ -348,7 +1444,7 @@ ssize_t devAttrWiegandPulseIntervalMax_show(struct device *dev,
 		return -EFAULT;
 	}
 
-	return sprintf(buf, "%lu\n", w->pulseIntervalMax_usec);
+	return sprintf(buf, "%llu\n", div_u64(w->pulseIntervalMax_nsec, NSEC_PER_USEC));
 }
 
 ssize_t devAttrWiegandPulseIntervalMax_store(struct device *dev,
@@ -366,7 +1462,7 @@ ssize_t devAttrWiegandPulseIntervalMax_store(struct device *dev,
 		return ret;
 	}
 
-	w->pulseIntervalMax_usec = val;
+	w->pulseIntervalMax_nsec = (u64) val * NSEC_PER_USEC;
 
 	return count;
 }
@@ -379,7 +1475,7 @@ ssize_t devAttrWiegandPulseWidthMin_show(struct device *dev,
 		return -EFAULT;
 	}
 
-	return sprintf(buf, "%lu\n", w->pulseWidthMin_usec);
+	return sprintf(buf, "%llu\n", div_u64(w->pulseWidthMin_nsec, NSEC_PER_USEC));
 }
 
 ssize_t devAttrWiegandPulseWidthMin_store(struct device *dev,
@@ -397,7 +1493,7 @@ ssize_t devAttrWiegandPulseWidthMin_store(struct device *dev,
 		return ret;
 	}
 
-	w->pulseWidthMin_usec = val;
+	w->pulseWidthMin_nsec = (u64) val * NSEC_PER_USEC;
 
 	return count;
 }
@@ -410,7 +1506,7 @@ ssize_t devAttrWiegandPulseWidthMax_show(struct device *dev,
 		return -EFAULT;
 	}
 
-	return sprintf(buf, "%lu\n", w->pulseWidthMax_usec);
+	return sprintf(buf, "%llu\n", div_u64(w->pulseWidthMax_nsec, NSEC_PER_USEC));
 }
 
 ssize_t devAttrWiegandPulseWidthMax_store(struct device *dev,
@@ -428,7 +1524,31 @@ ssize_t devAttrWiegandPulseWidthMax_store(struct device *dev,
 		return ret;
 	}
 
-	w->pulseWidthMax_usec = val;
+	w->pulseWidthMax_nsec = (u64) val * NSEC_PER_USEC;
 
 	return count;
 }
+
+/*
+ * Decodes wiegandTestVectors with all formats enabled. Returns 0 if every
+ * frame is recognized with the expected format and fields.
+ */
+int wiegandSelfTest(void) {
+	const struct WiegandTestVector *v;
+	struct WiegandFrame frame;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(wiegandTestVectors); i++) {
+		v = &wiegandTestVectors[i];
+		memset(&frame, 0, sizeof(frame));
+		frame.bits = v->bits;
+		frame.data = v->data;
+		if (!wiegandDecode(~0, &frame) || frame.format != v->format
+				|| frame.facility != v->facility || frame.card != v->card) {
+			pr_err("wiegand: self-test failed on %s\n",
+					wiegandFormats[v->format].name);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
@@ -3,6 +3,70 @@
 
 #include "../gpio/gpio.h"
 #include <linux/device.h>
+#include <linux/kfifo.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#define WIEGAND_FRAMES_QUEUE_SIZE 64
+#define WIEGAND_TX_QUEUE_SIZE 16
+#define WIEGAND_MAX_BITS 256
+#define WIEGAND_MAX_BYTES (WIEGAND_MAX_BITS / 8)
+#define WIEGAND_NOISE_MIN 10
+#define WIEGAND_NOISE_MAX 15
+#define WIEGAND_HIST_BUCKETS 64
+#define WIEGAND_HIST_SHIFT 10
+
+enum WiegandFormatId {
+	WIEGAND_FMT_NONE = 0,
+	WIEGAND_FMT_H10301,
+	WIEGAND_FMT_H10306,
+	WIEGAND_FMT_C1000,
+	WIEGAND_FMT_H10304,
+	WIEGAND_FMT_H10302,
+	WIEGAND_FMT_KP4,
+	WIEGAND_FMT_KP8,
+	WIEGAND_FMT_SIZE,
+};
+
+/*
+ * Record returned by read() on the /dev/<module>_w<N> character device,
+ * one per completed frame.
+ */
+struct WiegandFrame {
+	uint64_t ts;
+	uint64_t data;
+	int32_t bits;
+	int32_t noise;
+	uint64_t card;
+	uint32_t facility;
+	uint32_t format;
+	uint8_t raw[WIEGAND_MAX_BYTES];
+};
+
+/*
+ * Record written with write() on the /dev/<module>_w<N> character device,
+ * one per frame to transmit. Bits are packed MSB first, as in
+ * WiegandFrame.raw.
+ */
+struct WiegandTxFrame {
+	int32_t bits;
+	uint8_t raw[WIEGAND_MAX_BYTES];
+};
+
+enum WiegandTxState {
+	WIEGAND_TX_GAP = 0,
+	WIEGAND_TX_PULSE,
+	WIEGAND_TX_SPACE,
+};
+
+struct WiegandStats {
+	unsigned long noise[WIEGAND_NOISE_MAX - WIEGAND_NOISE_MIN + 1];
+	unsigned long pulseWidth[WIEGAND_HIST_BUCKETS];
+	unsigned long pulseInterval[WIEGAND_HIST_BUCKETS];
+};
 
 struct WiegandLine {
 	struct GpioBean *gpio;
@@ -12,39 +76,135 @@ struct WiegandLine {
 };
 
 struct WiegandBean {
+	// '1', '2', ...: set by the user, names the character device
 	char id;
 	struct WiegandLine d0;
 	struct WiegandLine d1;
 	struct WiegandLine *activeLine;
-	unsigned long pulseIntervalMin_usec;
-	unsigned long pulseIntervalMax_usec;
-	unsigned long pulseWidthMin_usec;
-	unsigned long pulseWidthMax_usec;
+	u64 pulseIntervalMin_nsec;
+	u64 pulseIntervalMax_nsec;
+	u64 pulseWidthMin_nsec;
+	u64 pulseWidthMax_nsec;
 	bool enabled;
 	uint64_t data;
+	uint8_t raw[WIEGAND_MAX_BYTES];
 	int bitCount;
+	int maxBits;
 	int noise;
-	struct timespec64 lastBitTs;
+	int frameNoise;
+	ktime_t lastBitTime;
+	ktime_t frameEnd;
+	bool timerArmed;
+	u64 irqMax_nsec;
 	struct hrtimer timer;
 	struct kernfs_node *notifKn;
+	struct kernfs_node *notifCardKn;
+	uint32_t formats;
+	unsigned long invalidCnt;
+	struct WiegandStats __percpu *stats;
+	spinlock_t lock;
+	struct WiegandFrame lastFrame;
+	struct WiegandFrame lastCard;
+	DECLARE_KFIFO(frames, struct WiegandFrame, WIEGAND_FRAMES_QUEUE_SIZE);
+	wait_queue_head_t readQueue;
+	struct mutex readLock;
+	char devName[32];
+	struct miscdevice miscDev;
+	bool miscDevRegistered;
+	bool txEnabled;
+	bool txBusy;
+	enum WiegandTxState txState;
+	struct WiegandTxFrame txFrame;
+	int txBit;
+	struct GpioBean *txGpio;
+	u64 txWidth_nsec;
+	u64 txSpace_nsec;
+	u64 txGap_nsec;
+	unsigned long txCnt;
+	struct hrtimer txTimer;
+	struct kernfs_node *notifTxCntKn;
+	DECLARE_KFIFO(txFrames, struct WiegandTxFrame, WIEGAND_TX_QUEUE_SIZE);
+	wait_queue_head_t writeQueue;
+	struct mutex writeLock;
 };
 
-void wiegandInit(struct WiegandBean *w);
+int wiegandInit(struct WiegandBean *w);
+
+int wiegandSelfTest(void);
 
 void wiegandDisable(struct WiegandBean *w);
 
+void wiegandFree(struct WiegandBean *w);
+
 ssize_t devAttrWiegandEnabled_show(struct device *dev,
 		struct device_attribute *attr, char *buf);
 
 ssize_t devAttrWiegandEnabled_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count);
 
+ssize_t devAttrWiegandTxEnabled_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandTxEnabled_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandTx_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandTxCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
 ssize_t devAttrWiegandData_show(struct device *dev,
 		struct device_attribute *attr, char *buf);
 
+ssize_t devAttrWiegandDataHex_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandMaxBits_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandMaxBits_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandCard_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandFormats_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandFormats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandInvalidCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
 ssize_t devAttrWiegandNoise_show(struct device *dev,
 		struct device_attribute *attr, char *buf);
 
+ssize_t devAttrWiegandNoiseCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandNoiseCnt_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandPulseWidthHist_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandPulseWidthHist_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandPulseIntervalHist_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandPulseIntervalHist_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+ssize_t devAttrWiegandIrqMax_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+ssize_t devAttrWiegandIrqMax_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
 ssize_t devAttrWiegandPulseIntervalMin_show(struct device *dev,
 		struct device_attribute *attr, char *buf);
 
@@ -16,6 +16,7 @@
 #include "commons/gpio/gpio.h"
 #include "commons/wiegand/wiegand.h"
 #include "commons/atecc/atecc.h"
+#include "commons/crc/crc.h"
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
@@ -23,25 +24,62 @@
 #include <linux/delay.h>
 #include <linux/i2c.h>
 #include <linux/version.h>
+#include <linux/watchdog.h>
+#include <linux/power_supply.h>
+#include <linux/workqueue.h>
+#include <linux/reboot.h>
+#include <linux/miscdevice.h>
+#include <linux/kfifo.h>
+#include <linux/poll.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+#include <linux/async.h>
 
 #define I2C_ADDR_LOCAL 0x35
 
 #define LOG_TAG "ionopimax: "
 
 struct DeviceAttrRegSpecs {
-	uint16_t reg;
+	uint8_t reg;
 	uint8_t len;
-	bool maskedReg;
-	uint32_t mask;
 	uint8_t shift;
+	bool maskedReg;
 	bool sign;
+	uint32_t mask;
 	const char *vals;
 };
 
+/*
+ * Register specs live in .rodata, shared by reference; attributes not
+ * mapped on a register (or not written to a different one) have NULL.
+ */
+#define REG_SPECS(_reg, _len, _maskedReg, _mask, _shift, _sign, _vals) \
+	(&(const struct DeviceAttrRegSpecs) { \
+		.reg = _reg, \
+		.len = _len, \
+		.shift = _shift, \
+		.maskedReg = _maskedReg, \
+		.sign = _sign, \
+		.mask = _mask, \
+		.vals = _vals, \
+	})
+
+#define DEV_ATTR(_name, _mode, _show, _store) \
+	.devAttr = { \
+		.attr = { \
+			.name = _name, \
+			.mode = _mode, \
+		}, \
+		.show = _show, \
+		.store = _store, \
+	}
+
 struct DeviceAttrBean {
 	struct device_attribute devAttr;
-	struct DeviceAttrRegSpecs regSpecs;
-	struct DeviceAttrRegSpecs regSpecsStore;
+	const struct DeviceAttrRegSpecs *regSpecs;
+	const struct DeviceAttrRegSpecs *regSpecsStore;
 	struct GpioBean *gpio;
 };
 
@@ -49,6 +87,9 @@ struct DeviceBean {
 	char *name;
 	struct device *pDevice;
 	struct DeviceAttrBean *devAttrBeans;
+	struct attribute **attrs;
+	struct attribute_group group;
+	const struct attribute_group *groups[2];
 };
 
 static struct class *pDeviceClass;
@@ -71,6 +112,153 @@ static ssize_t devAttrUpsBatteryV_store(struct device *dev,
 static ssize_t devAttrUpsBatteryV_show(struct device *dev,
 		struct device_attribute *attr, char *buf);
 
+static ssize_t devAttrUpsShutdownCharge_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrUpsShutdownCharge_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrUpsShutdownTime_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrUpsShutdownTime_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrSysStatePollInterval_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSysStatePollInterval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrAnalogPollInterval_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrAnalogPollInterval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrAnalogDeadband_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrAnalogDeadband_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrAnalogAlarmCfg_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrAnalogAlarmCfg_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrAnalogAlarm_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrAnalogAlarm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrOutFaultPollInterval_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrOutFaultPollInterval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrOutFaultCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrOutFaultCnt_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrOutFaultTs_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanEnabled_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanEnabled_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrScanCycle_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanCycle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrScanCycleCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanOverrunCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanErrCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanDuration_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanDurationMax_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanJitterMax_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrScanStats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrSchedPeriod_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSchedPeriod_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrSchedLateCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSchedBusBudget_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSchedBusBudget_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrSchedBusUtil_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSchedCacheHitCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSchedCacheMissCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrSchedCoalescedCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrI2cLaneStats_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrI2cLaneStats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrMcuWritePolicy_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrMcuWritePolicy_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrMcuWriteVerifyErrCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrMcuI2cCombined_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrMcuI2cCombined_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t devAttrMcuI2cCombinedCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrMcuI2cCombinedErrCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrMcuCacheSync_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
 static ssize_t devAttrSdEnabled_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count);
 
@@ -236,6 +424,7 @@ static struct GpioBean gpioSwReset = {
 };
 
 static struct WiegandBean w1 = {
+	.id = '1',
 	.d0 = {
 		.gpio = &gpioDT[DT1],
 	},
@@ -245,6 +434,7 @@ static struct WiegandBean w1 = {
 };
 
 static struct WiegandBean w2 = {
+	.id = '2',
 	.d0 = {
 		.gpio = &gpioDT[DT3],
 	},
@@ -255,26 +445,11 @@ static struct WiegandBean w2 = {
 
 static struct DeviceAttrBean devAttrBeansBuzzer[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("status", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioBuzzer,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "beep",
-				.mode = 0220,
-			},
-			.show = NULL,
-			.store = devAttrGpioBlink_store,
-		},
+		DEV_ATTR("beep", 0220, NULL, devAttrGpioBlink_store),
 		.gpio = &gpioBuzzer,
 	},
 
@@ -283,50 +458,20 @@ static struct DeviceAttrBean devAttrBeansBuzzer[] = {
 
 static struct DeviceAttrBean devAttrBeansButton[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("status", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioButton.gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status_deb",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDeb_show,
-			.store = NULL,
-		},
+		DEV_ATTR("status_deb", 0440, devAttrGpioDeb_show, NULL),
 		.gpio = &gpioButton.gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status_deb_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOn_show,
-			.store = devAttrGpioDebMsOn_store,
-		},
+		DEV_ATTR("status_deb_ms", 0660, devAttrGpioDebMsOn_show,
+				devAttrGpioDebMsOn_store),
 		.gpio = &gpioButton.gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status_deb_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOnCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("status_deb_cnt", 0440, devAttrGpioDebOnCnt_show, NULL),
 		.gpio = &gpioButton.gpio,
 	},
 
@@ -335,403 +480,84 @@ static struct DeviceAttrBean devAttrBeansButton[] = {
 
 static struct DeviceAttrBean devAttrBeansLed[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l1_r",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 105,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l1_r", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(105, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l1_g",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 106,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l1_g", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(106, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l1_b",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 107,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l1_b", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(107, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l1_br",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 108,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l1_br", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(108, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l2_r",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 110,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l2_r", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(110, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l2_g",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 111,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l2_g", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(111, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l2_b",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 112,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l2_b", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(112, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l2_br",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 113,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l2_br", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(113, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l3_r",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 115,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l3_r", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(115, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l3_g",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 116,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l3_g", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(116, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l3_b",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 117,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l3_b", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(117, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l3_br",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 118,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l3_br", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(118, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l4_r",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 120,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l4_r", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(120, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l4_g",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 121,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l4_g", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(121, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l4_b",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 122,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l4_b", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(122, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l4_br",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 123,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l4_br", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(123, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l5_r",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 125,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l5_r", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(125, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l5_g",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 126,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l5_g", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(126, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l5_b",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 127,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l5_b", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(127, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "l5_br",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 128,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("l5_br", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(128, 2, false, 0xffff, 0, false, NULL),
 	},
 
 	{ }
@@ -739,542 +565,252 @@ static struct DeviceAttrBean devAttrBeansLed[] = {
 
 static struct DeviceAttrBean devAttrBeansAnalogIn[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "hsf",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("hsf", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 1, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av1_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 4,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("av1_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 4, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av2_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 5,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("av2_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 5, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av3_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 6,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("av3_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 6, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av4_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 7,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("av4_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 7, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai1_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 8,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai1_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 8, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai2_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 9,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai2_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 9, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai3_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 10,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai3_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 10, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai4_mode",
-				.mode = 0660,
-			},
-			.show = devAttrAxMode_show,
-			.store = devAttrAxMode_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 11,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai4_mode", 0660, devAttrAxMode_show, devAttrAxMode_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b1, 11, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "at1_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 12,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("at1_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b11, 12, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "at2_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 69,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 14,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("at2_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(69, 2, false, 0b11, 14, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av1",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 71,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("av1", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(71, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av2",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 72,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("av2", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(72, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av3",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 73,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("av3", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(73, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "av4",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 74,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("av4", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(74, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai1",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 75,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai1", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(75, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai2",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 76,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai2", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(76, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai3",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 77,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai3", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(77, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ai4",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 78,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("ai4", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(78, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "at1",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 79,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("at1", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(79, 3, false, 0xffffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "at2",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 80,
-			.len = 3,
-			.maskedReg = false,
-			.mask = 0xffffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("at2", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(80, 3, false, 0xffffff, 0, true, NULL),
 	},
-
-	{ }
-};
-
-static struct DeviceAttrBean devAttrBeansDigitalIO[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt1_mode",
-				.mode = 0660,
-			},
-			.show = devAttrGpioMode_show,
-			.store = devAttrGpioMode_store,
-		},
-		.gpio = &gpioDT[DT1],
+		DEV_ATTR("poll_interval", 0660, devAttrAnalogPollInterval_show,
+				devAttrAnalogPollInterval_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt2_mode",
-				.mode = 0660,
-			},
-			.show = devAttrGpioMode_show,
-			.store = devAttrGpioMode_store,
-		},
-		.gpio = &gpioDT[DT2],
+		DEV_ATTR("av1_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt3_mode",
-				.mode = 0660,
-			},
-			.show = devAttrGpioMode_show,
-			.store = devAttrGpioMode_store,
-		},
-		.gpio = &gpioDT[DT3],
+		DEV_ATTR("av2_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt4_mode",
-				.mode = 0660,
-			},
-			.show = devAttrGpioMode_show,
-			.store = devAttrGpioMode_store,
-		},
-		.gpio = &gpioDT[DT4],
+		DEV_ATTR("av3_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
 	},
+	{
+		DEV_ATTR("av4_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("ai1_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("ai2_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("ai3_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("ai4_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("at1_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("at2_deadband", 0660, devAttrAnalogDeadband_show,
+				devAttrAnalogDeadband_store),
+	},
+	{
+		DEV_ATTR("av1_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("av1_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("av2_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("av2_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("av3_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("av3_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("av4_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("av4_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("ai1_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("ai1_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("ai2_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("ai2_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("ai3_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("ai3_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("ai4_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("ai4_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("at1_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("at1_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("at2_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("at2_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+
+	{ }
+};
 
+static struct DeviceAttrBean devAttrBeansDigitalIO[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt1",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("dt1_mode", 0660, devAttrGpioMode_show, devAttrGpioMode_store),
 		.gpio = &gpioDT[DT1],
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt2",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("dt2_mode", 0660, devAttrGpioMode_show, devAttrGpioMode_store),
 		.gpio = &gpioDT[DT2],
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt3",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("dt3_mode", 0660, devAttrGpioMode_show, devAttrGpioMode_store),
 		.gpio = &gpioDT[DT3],
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "dt4",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("dt4_mode", 0660, devAttrGpioMode_show, devAttrGpioMode_store),
+		.gpio = &gpioDT[DT4],
+	},
+	{
+		DEV_ATTR("dt1", 0660, devAttrGpio_show, devAttrGpio_store),
+		.gpio = &gpioDT[DT1],
+	},
+	{
+		DEV_ATTR("dt2", 0660, devAttrGpio_show, devAttrGpio_store),
+		.gpio = &gpioDT[DT2],
+	},
+	{
+		DEV_ATTR("dt3", 0660, devAttrGpio_show, devAttrGpio_store),
+		.gpio = &gpioDT[DT3],
+	},
+	{
+		DEV_ATTR("dt4", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioDT[DT4],
 	},
 
@@ -1283,290 +819,107 @@ static struct DeviceAttrBean devAttrBeansDigitalIO[] = {
 
 static struct DeviceAttrBean devAttrBeansDigitalIn[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di1",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di1", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioDI[DI1].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di2",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di2", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioDI[DI2].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di3",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di3", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioDI[DI3].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di4",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di4", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioDI[DI4].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di1_deb",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDeb_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di1_deb", 0440, devAttrGpioDeb_show, NULL),
 		.gpio = &gpioDI[DI1].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di2_deb",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDeb_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di2_deb", 0440, devAttrGpioDeb_show, NULL),
 		.gpio = &gpioDI[DI2].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di3_deb",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDeb_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di3_deb", 0440, devAttrGpioDeb_show, NULL),
 		.gpio = &gpioDI[DI3].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di4_deb",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDeb_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di4_deb", 0440, devAttrGpioDeb_show, NULL),
 		.gpio = &gpioDI[DI4].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di1_deb_on_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOn_show,
-			.store = devAttrGpioDebMsOn_store,
-		},
+		DEV_ATTR("di1_deb_on_ms", 0660, devAttrGpioDebMsOn_show,
+				devAttrGpioDebMsOn_store),
 		.gpio = &gpioDI[DI1].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di1_deb_off_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOff_show,
-			.store = devAttrGpioDebMsOff_store,
-		},
+		DEV_ATTR("di1_deb_off_ms", 0660, devAttrGpioDebMsOff_show,
+				devAttrGpioDebMsOff_store),
 		.gpio = &gpioDI[DI1].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di2_deb_on_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOn_show,
-			.store = devAttrGpioDebMsOn_store,
-		},
+		DEV_ATTR("di2_deb_on_ms", 0660, devAttrGpioDebMsOn_show,
+				devAttrGpioDebMsOn_store),
 		.gpio = &gpioDI[DI2].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di2_deb_off_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOff_show,
-			.store = devAttrGpioDebMsOff_store,
-		},
+		DEV_ATTR("di2_deb_off_ms", 0660, devAttrGpioDebMsOff_show,
+				devAttrGpioDebMsOff_store),
 		.gpio = &gpioDI[DI2].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di3_deb_on_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOn_show,
-			.store = devAttrGpioDebMsOn_store,
-		},
+		DEV_ATTR("di3_deb_on_ms", 0660, devAttrGpioDebMsOn_show,
+				devAttrGpioDebMsOn_store),
 		.gpio = &gpioDI[DI3].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di3_deb_off_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOff_show,
-			.store = devAttrGpioDebMsOff_store,
-		},
+		DEV_ATTR("di3_deb_off_ms", 0660, devAttrGpioDebMsOff_show,
+				devAttrGpioDebMsOff_store),
 		.gpio = &gpioDI[DI3].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di4_deb_on_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOn_show,
-			.store = devAttrGpioDebMsOn_store,
-		},
+		DEV_ATTR("di4_deb_on_ms", 0660, devAttrGpioDebMsOn_show,
+				devAttrGpioDebMsOn_store),
 		.gpio = &gpioDI[DI4].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di4_deb_off_ms",
-				.mode = 0660,
-			},
-			.show = devAttrGpioDebMsOff_show,
-			.store = devAttrGpioDebMsOff_store,
-		},
+		DEV_ATTR("di4_deb_off_ms", 0660, devAttrGpioDebMsOff_show,
+				devAttrGpioDebMsOff_store),
 		.gpio = &gpioDI[DI4].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di1_deb_on_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOnCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di1_deb_on_cnt", 0440, devAttrGpioDebOnCnt_show, NULL),
 		.gpio = &gpioDI[DI1].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di1_deb_off_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOffCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di1_deb_off_cnt", 0440, devAttrGpioDebOffCnt_show, NULL),
 		.gpio = &gpioDI[DI1].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di2_deb_on_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOnCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di2_deb_on_cnt", 0440, devAttrGpioDebOnCnt_show, NULL),
 		.gpio = &gpioDI[DI2].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di2_deb_off_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOffCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di2_deb_off_cnt", 0440, devAttrGpioDebOffCnt_show, NULL),
 		.gpio = &gpioDI[DI2].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di3_deb_on_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOnCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di3_deb_on_cnt", 0440, devAttrGpioDebOnCnt_show, NULL),
 		.gpio = &gpioDI[DI3].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di3_deb_off_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOffCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di3_deb_off_cnt", 0440, devAttrGpioDebOffCnt_show, NULL),
 		.gpio = &gpioDI[DI3].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di4_deb_on_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOnCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di4_deb_on_cnt", 0440, devAttrGpioDebOnCnt_show, NULL),
 		.gpio = &gpioDI[DI4].gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "di4_deb_off_cnt",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDebOffCnt_show,
-			.store = NULL,
-		},
+		DEV_ATTR("di4_deb_off_cnt", 0440, devAttrGpioDebOffCnt_show, NULL),
 		.gpio = &gpioDI[DI4].gpio,
 	},
 
@@ -1575,255 +928,116 @@ static struct DeviceAttrBean devAttrBeansDigitalIn[] = {
 
 static struct DeviceAttrBean devAttrBeansDigitalOut[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "pdc",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 137,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 4,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("pdc", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(137, 2, false, 0b1, 4, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "o1",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 85,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 0,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 84,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("o1", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(85, 2, false, 0b11,
+				0, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(84, 2, true, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "o2",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 85,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 2,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 84,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("o2", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(85, 2, false, 0b11,
+				2, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(84, 2, true, 0b1, 1, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "o3",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 85,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 4,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 84,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 2,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("o3", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(85, 2, false, 0b11,
+				4, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(84, 2, true, 0b1, 2, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "o4",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 85,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 6,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 84,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 3,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("o4", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(85, 2, false, 0b11,
+				6, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(84, 2, true, 0b1, 3, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "oc1",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 90,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 0,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 89,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("oc1", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(90, 2, false, 0b11,
+				0, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(89, 2, true, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "oc2",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 90,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 2,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 89,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("oc2", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(90, 2, false, 0b11,
+				2, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(89, 2, true, 0b1, 1, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "oc3",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 90,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 4,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 89,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 2,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("oc3", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(90, 2, false, 0b11,
+				4, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(89, 2, true, 0b1, 2, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "oc4",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 90,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b11,
-			.shift = 6,
-			.sign = false,
-			.vals = VALS_DIGITAL_OUTS_STATUS,
-		},
-		.regSpecsStore = {
-			.reg = 89,
-			.len = 2,
-			.maskedReg = true,
-			.mask = 0b1,
-			.shift = 3,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("oc4", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(90, 2, false, 0b11,
+				6, false, VALS_DIGITAL_OUTS_STATUS),
+		.regSpecsStore = REG_SPECS(89, 2, true, 0b1, 3, false, NULL),
+	},
+	{
+		DEV_ATTR("fault_poll_interval", 0660, devAttrOutFaultPollInterval_show,
+				devAttrOutFaultPollInterval_store),
+	},
+	{
+		DEV_ATTR("o1_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("o1_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("o2_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("o2_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("o3_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("o3_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("o4_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("o4_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("oc1_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("oc1_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("oc2_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("oc2_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("oc3_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("oc3_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
+	},
+	{
+		DEV_ATTR("oc4_fault_cnt", 0660, devAttrOutFaultCnt_show,
+				devAttrOutFaultCnt_store),
+	},
+	{
+		DEV_ATTR("oc4_fault_ts", 0440, devAttrOutFaultTs_show, NULL),
 	},
 
 	{ }
@@ -1831,43 +1045,28 @@ static struct DeviceAttrBean devAttrBeansDigitalOut[] = {
 
 static struct DeviceAttrBean devAttrBeansPwrIn[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "mon_v",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 145,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("mon_v", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(145, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "mon_i",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 146,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("mon_i", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(146, 2, false, 0xffff, 0, false, NULL),
+	},
+	{
+		DEV_ATTR("mon_v_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("mon_v_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("mon_i_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("mon_i_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
 	},
 
 	{ }
@@ -1875,43 +1074,12 @@ static struct DeviceAttrBean devAttrBeansPwrIn[] = {
 
 static struct DeviceAttrBean devAttrBeansSysTemp[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "top",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 155,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("top", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(155, 2, false, 0xffff, 0, true, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "bottom",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 156,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = true,
-			.vals = NULL,
-		},
+		DEV_ATTR("bottom", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(156, 2, false, 0xffff, 0, true, NULL),
 	},
 
 	{ }
@@ -1919,119 +1087,33 @@ static struct DeviceAttrBean devAttrBeansSysTemp[] = {
 
 static struct DeviceAttrBean devAttrBeansWatchdog[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "enabled",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("enabled", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioWdEn,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "heartbeat",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("heartbeat", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioWdHeartbeat,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "expired",
-				.mode = 0440,
-			},
-			.show = devAttrGpioDeb_show,
-			.store = NULL,
-		},
+		DEV_ATTR("expired", 0440, devAttrGpioDeb_show, NULL),
 		.gpio = &gpioWdExpired.gpio,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "enable_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 29,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = VALS_WATCHDOG_ENABLE_MODE,
-		},
+		DEV_ATTR("enable_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(29, 2, false, 0xffff,
+				0, false, VALS_WATCHDOG_ENABLE_MODE),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "timeout",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 30,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("timeout", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(30, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "down_delay",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 31,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("down_delay", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(31, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sd_switch",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 32,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("sd_switch", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(32, 2, false, 0xffff, 0, false, NULL),
 	},
 
 	{ }
@@ -2039,339 +1121,103 @@ static struct DeviceAttrBean devAttrBeansWatchdog[] = {
 
 static struct DeviceAttrBean devAttrBeansPower[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "down_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("down_enabled", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioPwrDnwEn,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "down_enable_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 36,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = VALS_POWER_DOWN_ENABLE_MODE,
-		},
+		DEV_ATTR("down_enable_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(36, 2, false, 0b1,
+				0, false, VALS_POWER_DOWN_ENABLE_MODE),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "up_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 36,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = VALS_POWER_UP_MODE,
-		},
+		DEV_ATTR("up_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(36, 2, false, 0b1, 1, false, VALS_POWER_UP_MODE),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sd_switch",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 36,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 2,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("sd_switch", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(36, 2, false, 0b1, 2, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "down_delay",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 37,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("down_delay", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(37, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "off_time",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 38,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("off_time", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(38, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "up_delay",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 39,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("up_delay", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(39, 2, false, 0xffff, 0, false, NULL),
 	},
 
-	{ },
+	{ }
 };
 
 static struct DeviceAttrBean devAttrBeansUps[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 43,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(43, 2, false, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "battery_v",
-				.mode = 0660,
-			},
-			.show = devAttrUpsBatteryV_show,
-			.store = devAttrUpsBatteryV_store,
-		},
-		.regSpecs = {
-			.reg = 43,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("battery_v", 0660, devAttrUpsBatteryV_show,
+				devAttrUpsBatteryV_store),
+		.regSpecs = REG_SPECS(43, 2, false, 0b1, 1, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "battery_capacity",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 44,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("battery_capacity", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(44, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "battery_i_max",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 45,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("battery_i_max", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(45, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "power_delay",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 46,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("power_delay", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(46, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "battery",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 48,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 7,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("shutdown_charge", 0660, devAttrUpsShutdownCharge_show,
+				devAttrUpsShutdownCharge_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "battery_charge",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 48,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xff,
-			.shift = 8,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("shutdown_time", 0660, devAttrUpsShutdownTime_show,
+				devAttrUpsShutdownTime_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 48,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1111,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("battery", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(48, 2, false, 0b1, 7, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "charger_mon_v",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 147,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("battery_charge", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(48, 2, false, 0xff, 8, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "charger_mon_i",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 148,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("status", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(48, 2, false, 0b1111, 0, false, NULL),
+	},
+	{
+		DEV_ATTR("charger_mon_v", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(147, 2, false, 0xffff, 0, false, NULL),
+	},
+	{
+		DEV_ATTR("charger_mon_i", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(148, 2, false, 0xffff, 0, false, NULL),
+	},
+	{
+		DEV_ATTR("charger_mon_v_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("charger_mon_v_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("charger_mon_i_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("charger_mon_i_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
 	},
 
 	{ }
@@ -2379,83 +1225,22 @@ static struct DeviceAttrBean devAttrBeansUps[] = {
 
 static struct DeviceAttrBean devAttrBeansSd[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sdx_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrSdEnabled_show,
-			.store = devAttrSdEnabled_store,
-		},
-		.regSpecs = {
-			.reg = 52,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0x0101,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("sdx_enabled", 0660, devAttrSdEnabled_show,
+				devAttrSdEnabled_store),
+		.regSpecs = REG_SPECS(52, 2, false, 0x0101, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sd1_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrSdEnabled_show,
-			.store = devAttrSdEnabled_store,
-		},
-		.regSpecs = {
-			.reg = 52,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0x0101,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("sd1_enabled", 0660, devAttrSdEnabled_show,
+				devAttrSdEnabled_store),
+		.regSpecs = REG_SPECS(52, 2, false, 0x0101, 1, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sdx_default",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 52,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 2,
-			.sign = false,
-			.vals = VALS_SD_SDX_ROUTING,
-		},
+		DEV_ATTR("sdx_default", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(52, 2, false, 0b1, 2, false, VALS_SD_SDX_ROUTING),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sdx_routing",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 52,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 3,
-			.sign = false,
-			.vals = VALS_SD_SDX_ROUTING,
-		},
+		DEV_ATTR("sdx_routing", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(52, 2, false, 0b1, 3, false, VALS_SD_SDX_ROUTING),
 	},
 
 	{ }
@@ -2463,50 +1248,19 @@ static struct DeviceAttrBean devAttrBeansSd[] = {
 
 static struct DeviceAttrBean devAttrBeansUsb[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "usb1_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("usb1_enabled", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioUsb1En,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "usb1_err",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("usb1_err", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioUsb1Err,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "usb2_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
+		DEV_ATTR("usb2_enabled", 0660, devAttrGpio_show, devAttrGpio_store),
 		.gpio = &gpioUsb2En,
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "usb2_err",
-				.mode = 0440,
-			},
-			.show = devAttrGpio_show,
-			.store = NULL,
-		},
+		DEV_ATTR("usb2_err", 0440, devAttrGpio_show, NULL),
 		.gpio = &gpioUsb2Err,
 	},
 
@@ -2515,163 +1269,38 @@ static struct DeviceAttrBean devAttrBeansUsb[] = {
 
 static struct DeviceAttrBean devAttrBeansAnalogOut[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao1_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 94,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao1_enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(94, 2, false, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao1_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 94,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = VALS_ANALOG_OUTS_MODE,
-		},
+		DEV_ATTR("ao1_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(94, 2, false, 0b1,
+				1, false, VALS_ANALOG_OUTS_MODE),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao1",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 95,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao1", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(95, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao1_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 96,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b111,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao1_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(96, 2, false, 0b111, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao2_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 99,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao2_enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(99, 2, false, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao2_mode",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 99,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = VALS_ANALOG_OUTS_MODE,
-		},
+		DEV_ATTR("ao2_mode", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(99, 2, false, 0b1,
+				1, false, VALS_ANALOG_OUTS_MODE),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao2",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 100,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao2", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(100, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao2_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 101,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b111,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao2_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(101, 2, false, 0b111, 0, false, NULL),
 	},
 
 	{ }
@@ -2679,103 +1308,40 @@ static struct DeviceAttrBean devAttrBeansAnalogOut[] = {
 
 static struct DeviceAttrBean devAttrBeansPowerOut[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "vso_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 132,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("vso_enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(132, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "vso",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 133,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("vso", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(133, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "vso_mon_v",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 149,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("vso_mon_v", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(149, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "vso_mon_i",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 150,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("vso_mon_i", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(150, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "5vo_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 137,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("5vo_enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(137, 2, false, 0b1, 1, false, NULL),
+	},
+	{
+		DEV_ATTR("vso_mon_v_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("vso_mon_v_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
+	},
+	{
+		DEV_ATTR("vso_mon_i_alarm_cfg", 0660, devAttrAnalogAlarmCfg_show,
+				devAttrAnalogAlarmCfg_store),
+	},
+	{
+		DEV_ATTR("vso_mon_i_alarm", 0660, devAttrAnalogAlarm_show,
+				devAttrAnalogAlarm_store),
 	},
 
 	{ }
@@ -2783,43 +1349,12 @@ static struct DeviceAttrBean devAttrBeansPowerOut[] = {
 
 static struct DeviceAttrBean devAttrBeansFan[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "always_on",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 137,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("always_on", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(137, 2, false, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("status", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 0, false, NULL),
 	},
 
 	{ }
@@ -2827,63 +1362,16 @@ static struct DeviceAttrBean devAttrBeansFan[] = {
 
 static struct DeviceAttrBean devAttrBeansExpBus[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "enabled",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 137,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 3,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("enabled", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(137, 2, false, 0b1, 3, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "aux",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 3,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("aux", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 3, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "5vx",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 137,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 2,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("5vx", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(137, 2, false, 0b1, 2, false, NULL),
 	},
 
 	{ }
@@ -2891,303 +1379,68 @@ static struct DeviceAttrBean devAttrBeansExpBus[] = {
 
 static struct DeviceAttrBean devAttrBeansSysState[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "status_all",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("poll_interval", 0660, devAttrSysStatePollInterval_show,
+				devAttrSysStatePollInterval_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "fan_status",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("status_all", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0xffff, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "5vo_prot",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 1,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("fan_status", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 0, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "5vx_prot",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 2,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("5vo_prot", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 1, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "expbus_aux",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 3,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("5vx_prot", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 2, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "vso_prot",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 4,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("expbus_aux", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 3, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao1_prot",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 5,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("vso_prot", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 4, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ao2_prot",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 6,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao1_prot", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 5, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "vso_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 7,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ao2_prot", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 6, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ad4112_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 8,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("vso_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 7, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "ups_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 9,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ad4112_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 8, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "led_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 10,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("ups_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 9, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sys_temp_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 11,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("led_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 10, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "rs232_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 12,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("sys_temp_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 11, false, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "rs485_err",
-				.mode = 0440,
-			},
-			.show = devAttrI2c_show,
-			.store = NULL,
-		},
-		.regSpecs = {
-			.reg = 140,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 13,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("rs232_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 12, false, NULL),
+	},
+	{
+		DEV_ATTR("rs485_err", 0440, devAttrI2c_show, NULL),
+		.regSpecs = REG_SPECS(140, 2, false, 0b1, 13, false, NULL),
 	},
 
 	{ }
@@ -3195,352 +1448,398 @@ static struct DeviceAttrBean devAttrBeansSysState[] = {
 
 static struct DeviceAttrBean devAttrBeansWiegand[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandEnabled_show,
-			.store = devAttrWiegandEnabled_store,
-		}
+		DEV_ATTR("w1_enabled", 0660, devAttrWiegandEnabled_show,
+				devAttrWiegandEnabled_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_data",
-				.mode = 0440,
-			},
-			.show = devAttrWiegandData_show,
-			.store = NULL,
-		}
+		DEV_ATTR("w1_tx_enabled", 0660, devAttrWiegandTxEnabled_show,
+				devAttrWiegandTxEnabled_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_noise",
-				.mode = 0440,
-			},
-			.show = devAttrWiegandNoise_show,
-			.store = NULL,
-		}
+		DEV_ATTR("w1_tx", 0220, NULL, devAttrWiegandTx_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_pulse_itvl_min",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseIntervalMin_show,
-			.store = devAttrWiegandPulseIntervalMin_store,
-		}
+		DEV_ATTR("w1_tx_cnt", 0440, devAttrWiegandTxCnt_show, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_pulse_itvl_max",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseIntervalMax_show,
-			.store = devAttrWiegandPulseIntervalMax_store,
-		}
+		DEV_ATTR("w1_data", 0440, devAttrWiegandData_show, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_pulse_width_min",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseWidthMin_show,
-			.store = devAttrWiegandPulseWidthMin_store,
-		}
+		DEV_ATTR("w1_data_hex", 0440, devAttrWiegandDataHex_show, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w1_pulse_width_max",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseWidthMax_show,
-			.store = devAttrWiegandPulseWidthMax_store,
-		}
+		DEV_ATTR("w1_max_bits", 0660, devAttrWiegandMaxBits_show,
+				devAttrWiegandMaxBits_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_enabled",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandEnabled_show,
-			.store = devAttrWiegandEnabled_store,
-		}
+		DEV_ATTR("w1_card", 0440, devAttrWiegandCard_show, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_data",
-				.mode = 0440,
-			},
-			.show = devAttrWiegandData_show,
-			.store = NULL,
-		}
+		DEV_ATTR("w1_formats", 0660, devAttrWiegandFormats_show,
+				devAttrWiegandFormats_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_noise",
-				.mode = 0440,
-			},
-			.show = devAttrWiegandNoise_show,
-			.store = NULL,
-		}
+		DEV_ATTR("w1_invalid_cnt", 0440, devAttrWiegandInvalidCnt_show, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_pulse_itvl_min",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseIntervalMin_show,
-			.store = devAttrWiegandPulseIntervalMin_store,
-		}
+		DEV_ATTR("w1_noise", 0440, devAttrWiegandNoise_show, NULL),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_pulse_itvl_max",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseIntervalMax_show,
-			.store = devAttrWiegandPulseIntervalMax_store,
-		}
+		DEV_ATTR("w1_noise_cnt", 0660, devAttrWiegandNoiseCnt_show,
+				devAttrWiegandNoiseCnt_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_pulse_width_min",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseWidthMin_show,
-			.store = devAttrWiegandPulseWidthMin_store,
-		}
+		DEV_ATTR("w1_pulse_width_hist", 0660, devAttrWiegandPulseWidthHist_show,
+				devAttrWiegandPulseWidthHist_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "w2_pulse_width_max",
-				.mode = 0660,
-			},
-			.show = devAttrWiegandPulseWidthMax_show,
-			.store = devAttrWiegandPulseWidthMax_store,
-		}
+		DEV_ATTR("w1_pulse_itvl_hist", 0660, devAttrWiegandPulseIntervalHist_show,
+				devAttrWiegandPulseIntervalHist_store),
 	},
-
-	{ }
-};
-
-static struct DeviceAttrBean devAttrBeansMcu[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "fw_version",
-				.mode = 0440,
-			},
-			.show = devAttrMcuFwVersion_show,
-			.store = NULL,
-		}
+		DEV_ATTR("w1_irq_max_ns", 0660, devAttrWiegandIrqMax_show,
+				devAttrWiegandIrqMax_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "config",
-				.mode = 0220,
-			},
-			.show = NULL,
-			.store = devAttrMcuConfig_store,
-		}
+		DEV_ATTR("w1_pulse_itvl_min", 0660, devAttrWiegandPulseIntervalMin_show,
+				devAttrWiegandPulseIntervalMin_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sw_en",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
-		.gpio = &gpioSwEn,
+		DEV_ATTR("w1_pulse_itvl_max", 0660, devAttrWiegandPulseIntervalMax_show,
+				devAttrWiegandPulseIntervalMax_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "sw_reset",
-				.mode = 0660,
-			},
-			.show = devAttrGpio_show,
-			.store = devAttrGpio_store,
-		},
-		.gpio = &gpioSwReset,
+		DEV_ATTR("w1_pulse_width_min", 0660, devAttrWiegandPulseWidthMin_show,
+				devAttrWiegandPulseWidthMin_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "i2c_read",
-				.mode = 0660,
-			},
-			.show = mcuI2cRead_show,
-			.store = mcuI2cRead_store,
-		},
+		DEV_ATTR("w1_pulse_width_max", 0660, devAttrWiegandPulseWidthMax_show,
+				devAttrWiegandPulseWidthMax_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "i2c_write",
-				.mode = 0220,
-			},
-			.show = NULL,
-			.store = mcuI2cWrite_store,
-		},
+		DEV_ATTR("w2_enabled", 0660, devAttrWiegandEnabled_show,
+				devAttrWiegandEnabled_store),
 	},
-
-	{ }
-};
-
-static struct DeviceAttrBean devAttrBeansAtec[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "serial_num",
-				.mode = 0440,
-			},
-			.show = devAttrAteccSerial_show,
-			.store = NULL,
-		},
+		DEV_ATTR("w2_tx_enabled", 0660, devAttrWiegandTxEnabled_show,
+				devAttrWiegandTxEnabled_store),
 	},
-
-	{ }
-};
-
-static struct DeviceAttrBean devAttrBeansSerial[] = {
 	{
-		.devAttr = {
-			.attr = {
-				.name = "rs232_rs485_inv",
-				.mode = 0660,
-			},
-			.show = devAttrSerialRs232Rs485Inv_show,
-			.store = devAttrSerialRs232Rs485Inv_store,
-		},
-		.regSpecs = {
-			.reg = 26,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0xffff,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("w2_tx", 0220, NULL, devAttrWiegandTx_store),
 	},
-
 	{
-		.devAttr = {
-			.attr = {
-				.name = "rs485_txe",
-				.mode = 0660,
-			},
-			.show = devAttrI2c_show,
-			.store = devAttrI2c_store,
-		},
-		.regSpecs = {
-			.reg = 27,
-			.len = 2,
-			.maskedReg = false,
-			.mask = 0b1,
-			.shift = 0,
-			.sign = false,
-			.vals = NULL,
-		},
+		DEV_ATTR("w2_tx_cnt", 0440, devAttrWiegandTxCnt_show, NULL),
 	},
-
-	{ }
-};
-
-static struct DeviceBean devices[] = {
 	{
-		.name = "buzzer",
-		.devAttrBeans = devAttrBeansBuzzer,
+		DEV_ATTR("w2_data", 0440, devAttrWiegandData_show, NULL),
 	},
-
 	{
-		.name = "button",
-		.devAttrBeans = devAttrBeansButton,
+		DEV_ATTR("w2_data_hex", 0440, devAttrWiegandDataHex_show, NULL),
 	},
-
 	{
-		.name = "led",
-		.devAttrBeans = devAttrBeansLed,
+		DEV_ATTR("w2_max_bits", 0660, devAttrWiegandMaxBits_show,
+				devAttrWiegandMaxBits_store),
 	},
-
 	{
-		.name = "analog_in",
-		.devAttrBeans = devAttrBeansAnalogIn,
+		DEV_ATTR("w2_card", 0440, devAttrWiegandCard_show, NULL),
 	},
-
 	{
-		.name = "analog_out",
-		.devAttrBeans = devAttrBeansAnalogOut,
+		DEV_ATTR("w2_formats", 0660, devAttrWiegandFormats_show,
+				devAttrWiegandFormats_store),
 	},
-
 	{
-		.name = "digital_out",
-		.devAttrBeans = devAttrBeansDigitalOut,
+		DEV_ATTR("w2_invalid_cnt", 0440, devAttrWiegandInvalidCnt_show, NULL),
 	},
-
 	{
-		.name = "digital_in",
-		.devAttrBeans = devAttrBeansDigitalIn,
+		DEV_ATTR("w2_noise", 0440, devAttrWiegandNoise_show, NULL),
 	},
-
 	{
-		.name = "digital_io",
-		.devAttrBeans = devAttrBeansDigitalIO,
+		DEV_ATTR("w2_noise_cnt", 0660, devAttrWiegandNoiseCnt_show,
+				devAttrWiegandNoiseCnt_store),
 	},
-
 	{
-		.name = "power_in",
-		.devAttrBeans = devAttrBeansPwrIn,
+		DEV_ATTR("w2_pulse_width_hist", 0660, devAttrWiegandPulseWidthHist_show,
+				devAttrWiegandPulseWidthHist_store),
 	},
-
 	{
-		.name = "sys_temp",
-		.devAttrBeans = devAttrBeansSysTemp,
+		DEV_ATTR("w2_pulse_itvl_hist", 0660, devAttrWiegandPulseIntervalHist_show,
+				devAttrWiegandPulseIntervalHist_store),
 	},
-
 	{
-		.name = "watchdog",
-		.devAttrBeans = devAttrBeansWatchdog,
+		DEV_ATTR("w2_irq_max_ns", 0660, devAttrWiegandIrqMax_show,
+				devAttrWiegandIrqMax_store),
 	},
-
 	{
-		.name = "power",
-		.devAttrBeans = devAttrBeansPower,
+		DEV_ATTR("w2_pulse_itvl_min", 0660, devAttrWiegandPulseIntervalMin_show,
+				devAttrWiegandPulseIntervalMin_store),
+	},
+	{
+		DEV_ATTR("w2_pulse_itvl_max", 0660, devAttrWiegandPulseIntervalMax_show,
+				devAttrWiegandPulseIntervalMax_store),
+	},
+	{
+		DEV_ATTR("w2_pulse_width_min", 0660, devAttrWiegandPulseWidthMin_show,
+				devAttrWiegandPulseWidthMin_store),
+	},
+	{
+		DEV_ATTR("w2_pulse_width_max", 0660, devAttrWiegandPulseWidthMax_show,
+				devAttrWiegandPulseWidthMax_store),
+	},
+
+	{ }
+};
+
+static struct DeviceAttrBean devAttrBeansMcu[] = {
+	{
+		DEV_ATTR("fw_version", 0440, devAttrMcuFwVersion_show, NULL),
+	},
+	{
+		DEV_ATTR("config", 0220, NULL, devAttrMcuConfig_store),
+	},
+	{
+		DEV_ATTR("sw_en", 0660, devAttrGpio_show, devAttrGpio_store),
+		.gpio = &gpioSwEn,
+	},
+	{
+		DEV_ATTR("sw_reset", 0660, devAttrGpio_show, devAttrGpio_store),
+		.gpio = &gpioSwReset,
+	},
+	{
+		DEV_ATTR("i2c_read", 0660, mcuI2cRead_show, mcuI2cRead_store),
+	},
+	{
+		DEV_ATTR("i2c_write", 0220, NULL, mcuI2cWrite_store),
+	},
+	{
+		DEV_ATTR("write_policy", 0660, devAttrMcuWritePolicy_show,
+				devAttrMcuWritePolicy_store),
+	},
+	{
+		DEV_ATTR("write_verify_err_cnt", 0440, devAttrMcuWriteVerifyErrCnt_show,
+				NULL),
+	},
+	{
+		DEV_ATTR("i2c_critical_cnt", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_critical_timeout_cnt", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_critical_wait_avg_us", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_critical_wait_max_us", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_bulk_cnt", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_bulk_timeout_cnt", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_bulk_wait_avg_us", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_bulk_wait_max_us", 0660, devAttrI2cLaneStats_show,
+				devAttrI2cLaneStats_store),
+	},
+	{
+		DEV_ATTR("i2c_combined", 0660, devAttrMcuI2cCombined_show,
+				devAttrMcuI2cCombined_store),
+	},
+	{
+		DEV_ATTR("i2c_combined_cnt", 0440, devAttrMcuI2cCombinedCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("i2c_combined_err_cnt", 0440, devAttrMcuI2cCombinedErrCnt_show,
+				NULL),
+	},
+	{
+		DEV_ATTR("cache_sync", 0220, NULL, devAttrMcuCacheSync_store),
+	},
+
+	{ }
+};
+
+static struct DeviceAttrBean devAttrBeansAtec[] = {
+	{
+		DEV_ATTR("serial_num", 0440, devAttrAteccSerial_show, NULL),
+	},
+	{
+		DEV_ATTR("rng_bytes", 0440, devAttrAteccRngBytes_show, NULL),
+	},
+	{
+		DEV_ATTR("rng_err_cnt", 0440, devAttrAteccRngErrCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("rng_block_avg_us", 0440, devAttrAteccRngBlockAvg_show,
+				NULL),
+	},
+	{
+		DEV_ATTR("rng_block_max_us", 0440, devAttrAteccRngBlockMax_show,
+				NULL),
+	},
+
+	{ }
+};
+
+static struct DeviceAttrBean devAttrBeansSerial[] = {
+	{
+		DEV_ATTR("rs232_rs485_inv", 0660, devAttrSerialRs232Rs485Inv_show,
+				devAttrSerialRs232Rs485Inv_store),
+		.regSpecs = REG_SPECS(26, 2, false, 0xffff, 0, false, NULL),
+	},
+	{
+		DEV_ATTR("rs485_txe", 0660, devAttrI2c_show, devAttrI2c_store),
+		.regSpecs = REG_SPECS(27, 2, false, 0b1, 0, false, NULL),
+	},
+
+	{ }
+};
+
+static struct DeviceAttrBean devAttrBeansScan[] = {
+	{
+		DEV_ATTR("enabled", 0660, devAttrScanEnabled_show,
+				devAttrScanEnabled_store),
+	},
+	{
+		DEV_ATTR("cycle_us", 0660, devAttrScanCycle_show,
+				devAttrScanCycle_store),
+	},
+	{
+		DEV_ATTR("cycle_cnt", 0440, devAttrScanCycleCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("overrun_cnt", 0660, devAttrScanOverrunCnt_show,
+				devAttrScanStats_store),
+	},
+	{
+		DEV_ATTR("err_cnt", 0660, devAttrScanErrCnt_show,
+				devAttrScanStats_store),
+	},
+	{
+		DEV_ATTR("duration", 0440, devAttrScanDuration_show, NULL),
+	},
+	{
+		DEV_ATTR("duration_max", 0660, devAttrScanDurationMax_show,
+				devAttrScanStats_store),
+	},
+	{
+		DEV_ATTR("jitter_max", 0660, devAttrScanJitterMax_show,
+				devAttrScanStats_store),
+	},
+
+	{ }
+};
+
+static struct DeviceAttrBean devAttrBeansSched[] = {
+	{
+		DEV_ATTR("analog_period_ms", 0660, devAttrSchedPeriod_show,
+				devAttrSchedPeriod_store),
+	},
+	{
+		DEV_ATTR("analog_late_cnt", 0440, devAttrSchedLateCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("monitors_period_ms", 0660, devAttrSchedPeriod_show,
+				devAttrSchedPeriod_store),
+	},
+	{
+		DEV_ATTR("monitors_late_cnt", 0440, devAttrSchedLateCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("status_period_ms", 0660, devAttrSchedPeriod_show,
+				devAttrSchedPeriod_store),
+	},
+	{
+		DEV_ATTR("status_late_cnt", 0440, devAttrSchedLateCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("bus_budget", 0660, devAttrSchedBusBudget_show,
+				devAttrSchedBusBudget_store),
+	},
+	{
+		DEV_ATTR("bus_util", 0440, devAttrSchedBusUtil_show, NULL),
+	},
+	{
+		DEV_ATTR("cache_hit_cnt", 0440, devAttrSchedCacheHitCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("cache_miss_cnt", 0440, devAttrSchedCacheMissCnt_show, NULL),
+	},
+	{
+		DEV_ATTR("coalesced_cnt", 0440, devAttrSchedCoalescedCnt_show, NULL),
+	},
+
+	{ }
+};
+
+static struct DeviceBean devices[] = {
+	{
+		.name = "buzzer",
+		.devAttrBeans = devAttrBeansBuzzer,
+	},
+
+	{
+		.name = "button",
+		.devAttrBeans = devAttrBeansButton,
+	},
+
+	{
+		.name = "led",
+		.devAttrBeans = devAttrBeansLed,
+	},
+
+	{
+		.name = "analog_in",
+		.devAttrBeans = devAttrBeansAnalogIn,
+	},
+
+	{
+		.name = "analog_out",
+		.devAttrBeans = devAttrBeansAnalogOut,
+	},
+
+	{
+		.name = "digital_out",
+		.devAttrBeans = devAttrBeansDigitalOut,
+	},
+
+	{
+		.name = "digital_in",
+		.devAttrBeans = devAttrBeansDigitalIn,
+	},
+
+	{
+		.name = "digital_io",
+		.devAttrBeans = devAttrBeansDigitalIO,
+	},
+
+	{
+		.name = "power_in",
+		.devAttrBeans = devAttrBeansPwrIn,
+	},
+
+	{
+		.name = "sys_temp",
+		.devAttrBeans = devAttrBeansSysTemp,
+	},
+
+	{
+		.name = "watchdog",
+		.devAttrBeans = devAttrBeansWatchdog,
+	},
+
+	{
+		.name = "power",
+		.devAttrBeans = devAttrBeansPower,
 	},
 
 	{
@@ -3598,89 +1897,338 @@ static struct DeviceBean devices[] = {
 		.devAttrBeans = devAttrBeansSerial,
 	},
 
-	{ }
-};
+	{
+		.name = "scan",
+		.devAttrBeans = devAttrBeansScan,
+	},
 
-struct i2c_client *ionopimax_i2c_client = NULL;
+	{
+		.name = "sched",
+		.devAttrBeans = devAttrBeansSched,
+	},
 
-struct ionopimax_i2c_data {
-	struct mutex update_lock;
+	{ }
 };
 
-struct GpioBean* gpioGetBean(struct device *dev, struct device_attribute *attr,
-                             const char **vals) {
-	struct DeviceAttrBean *dab;
-	dab = container_of(attr, struct DeviceAttrBean, devAttr);
-	if (dab == NULL) {
-		return NULL;
-	}
-	return dab->gpio;
-}
+struct i2c_client *ionopimax_i2c_client = NULL;
+static struct workqueue_struct *ionopimaxWq = NULL;
 
-struct WiegandBean* wiegandGetBean(struct device *dev,
-		struct device_attribute *attr) {
-	if (attr->attr.name[1] == '1') {
-		return &w1;
-	} else {
-		return &w2;
-	}
-}
+static struct device *ionopimax_get_device(struct DeviceAttrBean *beans) {
+	struct DeviceBean *db;
 
-static bool ionopimax_i2c_lock(void) {
-	uint8_t i;
-	struct ionopimax_i2c_data *data;
-	if (!ionopimax_i2c_client) {
-		return false;
-	}
-	data = i2c_get_clientdata(ionopimax_i2c_client);
-	for (i = 0; i < 20; i++) {
-		if (mutex_trylock(&data->update_lock)) {
-			return true;
+	for (db = devices; db->name != NULL; db++) {
+		if (db->devAttrBeans == beans) {
+			// not created yet while the deferred init is running
+			return IS_ERR_OR_NULL(db->pDevice) ? NULL : db->pDevice;
 		}
-		msleep(1);
 	}
-	return false;
+	return NULL;
 }
 
-static void ionopimax_i2c_unlock(void) {
-	struct ionopimax_i2c_data *data;
-	if (ionopimax_i2c_client) {
-		data = i2c_get_clientdata(ionopimax_i2c_client);
-		mutex_unlock(&data->update_lock);
-	}
-}
+enum I2cLane {
+	I2C_LANE_CRITICAL = 0,
+	I2C_LANE_BULK,
+	I2C_LANE_SIZE,
+};
 
-static uint8_t ionopimax_i2c_crc_process(uint8_t crc, uint8_t dByte) {
-	uint8_t k;
-	crc ^= dByte;
-	for (k = 0; k < 8; k++)
-		crc = crc & 0x80 ? (crc << 1) ^ 0x2f : crc << 1;
-	return crc;
-}
+struct I2cLaneStats {
+	unsigned long cnt;
+	unsigned long timeoutCnt;
+	u64 waitTotal_nsec;
+	u64 waitMax_nsec;
+};
 
-static void ionopimax_i2c_add_crc(int reg, char *data, uint8_t len) {
-	uint8_t i;
-	uint8_t crc;
+struct ionopimax_i2c_data {
+	spinlock_t laneLock;
+	wait_queue_head_t laneQueue;
+	bool busy;
+	unsigned int waiting[I2C_LANE_SIZE];
+};
 
-	crc = ionopimax_i2c_crc_process(0xff, reg);
-	for (i = 0; i < len; i++) {
-		crc = ionopimax_i2c_crc_process(crc, data[i]);
-	}
-	data[len] = crc;
-}
+static const char *i2cLaneNames[I2C_LANE_SIZE] = {
+	[I2C_LANE_CRITICAL] = "critical",
+	[I2C_LANE_BULK] = "bulk",
+};
+static const unsigned int i2cLaneTimeout_ms[I2C_LANE_SIZE] = {
+	[I2C_LANE_CRITICAL] = 100,
+	[I2C_LANE_BULK] = 20,
+};
+static struct I2cLaneStats i2cLaneStats[I2C_LANE_SIZE];
 
-static int32_t ionopimax_i2c_read_no_lock(uint8_t reg, uint8_t len) {
-	int32_t res;
-	char buf[4];
-	uint8_t i;
-	uint8_t crc;
+#define REG_CACHE_SIZE 256
 
-	if (!ionopimax_i2c_client) {
-		return -EIO;
-	}
+/*
+ * Last value read by the scheduler for each register it polls, or
+ * -ENODATA, and the length it was read with. Registers never polled,
+ * and reads with a different length, always go to the bus.
+ */
+static int32_t regCache[REG_CACHE_SIZE] = {
+	[0 ... REG_CACHE_SIZE - 1] = -ENODATA
+};
+static uint8_t regCacheLen[REG_CACHE_SIZE];
+static unsigned long regCacheHitCnt = 0;
+static unsigned long regCacheMissCnt = 0;
+
+enum WritePolicy {
+	WRITE_POLICY_VERIFY = 0,
+	WRITE_POLICY_VERIFY_DEFERRED,
+	WRITE_POLICY_TRUST_CRC,
+	WRITE_POLICY_SIZE,
+};
 
-	if (fwVerMajor > 1 || fwVerMinor >= 4) {
-		len++;
+static const char *writePolicyNames[WRITE_POLICY_SIZE] = {
+	[WRITE_POLICY_VERIFY] = "verify",
+	[WRITE_POLICY_VERIFY_DEFERRED] = "verify-deferred",
+	[WRITE_POLICY_TRUST_CRC] = "trust-crc",
+};
+
+struct WriteVerify {
+	uint8_t reg;
+	bool maskedReg;
+	uint16_t mask;
+	uint16_t val;
+	unsigned int gen;
+};
+
+#define WRITE_VERIFY_QUEUE_SIZE 16
+
+static enum WritePolicy writePolicy = WRITE_POLICY_VERIFY;
+static unsigned long writeVerifyErrCnt = 0;
+static DEFINE_KFIFO(writeVerifyQueue, struct WriteVerify,
+		WRITE_VERIFY_QUEUE_SIZE);
+static DEFINE_SPINLOCK(writeVerifyLock);
+// writeVerifyWork is only queued, holding writeVerifyLock, while started
+static bool writeVerifyStarted = false;
+
+/*
+ * Last known content of each 16-bit register, used instead of reading
+ * it back for read-modify-write when the write policy is not "verify".
+ * -ENODATA when unknown.
+ */
+static int32_t regShadow[REG_CACHE_SIZE] = {
+	[0 ... REG_CACHE_SIZE - 1] = -ENODATA
+};
+
+/*
+ * Number of writes sent to each register, updated holding the bus. A
+ * deferred read back is skipped if the register was written again after
+ * it was queued, as it would compare against a superseded value.
+ */
+static unsigned int regWriteGen[REG_CACHE_SIZE];
+
+#define I2C_COMBINED_MAX_FAILS 3
+
+static bool i2cCombined = false;
+static unsigned int i2cCombinedFails = 0;
+static unsigned long i2cCombinedCnt = 0;
+static unsigned long i2cCombinedErrCnt = 0;
+
+/*
+ * Register map of the MCU, caching the configuration registers. Which
+ * registers are readable, writable and volatile is derived from the
+ * attribute tables at init (see ionopimax_regmap_build()).
+ */
+static struct regmap *ionopimaxRegmap = NULL;
+static DECLARE_BITMAP(regmapReadable, REG_CACHE_SIZE);
+static DECLARE_BITMAP(regmapWriteable, REG_CACHE_SIZE);
+static DECLARE_BITMAP(regmapVolatile, REG_CACHE_SIZE);
+// registers written through the map, rewritten by a cache sync
+static DECLARE_BITMAP(regmapWritten, REG_CACHE_SIZE);
+
+/*
+ * Configuration registers the MCU changes by itself, turning outputs off
+ * when a protection trips: analog outputs (94, 99), VSO (132), 5VO, 5VX,
+ * expansion bus and fan (137). Never cached nor shadowed, as a protection
+ * can trip while the sys_state poller is off.
+ */
+static const uint8_t mcuChangedRegs[] = { 94, 99, 132, 137, 0 };
+
+static bool ionopimax_reg_mcu_changed(uint8_t reg) {
+	const uint8_t *r;
+
+	for (r = mcuChangedRegs; *r != 0; r++) {
+		if (*r == reg) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ionopimax_regmap_cached(uint8_t reg) {
+	return ionopimaxRegmap != NULL && test_bit(reg, regmapReadable)
+			&& test_bit(reg, regmapWriteable) && !test_bit(reg, regmapVolatile);
+}
+
+static void ionopimax_regmap_drop(uint8_t min, uint8_t max) {
+	if (ionopimaxRegmap != NULL) {
+		regcache_drop_region(ionopimaxRegmap, min, max);
+	}
+}
+
+static void ionopimax_shadow_invalidate_all(void) {
+	int i;
+
+	for (i = 0; i < REG_CACHE_SIZE; i++) {
+		WRITE_ONCE(regShadow[i], -ENODATA);
+	}
+	ionopimax_regmap_drop(0, REG_CACHE_SIZE - 1);
+}
+
+/*
+ * Register read currently on the bus; concurrent readers of the same
+ * register and length wait for it and get its result instead of issuing
+ * their own. resLen is the length of the read that produced res.
+ */
+struct I2cFlight {
+	bool active;
+	uint8_t len;
+	uint8_t resLen;
+	int32_t res;
+	unsigned long gen;
+};
+
+static struct I2cFlight i2cFlights[REG_CACHE_SIZE];
+static DEFINE_SPINLOCK(i2cFlightLock);
+static DECLARE_WAIT_QUEUE_HEAD(i2cFlightQueue);
+static unsigned long i2cFlightCoalescedCnt = 0;
+
+struct GpioBean* gpioGetBean(struct device *dev, struct device_attribute *attr,
+                             const char **vals) {
+	struct DeviceAttrBean *dab;
+	dab = container_of(attr, struct DeviceAttrBean, devAttr);
+	if (dab == NULL) {
+		return NULL;
+	}
+	return dab->gpio;
+}
+
+struct WiegandBean* wiegandGetBean(struct device *dev,
+		struct device_attribute *attr) {
+	if (attr->attr.name[1] == '1') {
+		return &w1;
+	} else {
+		return &w2;
+	}
+}
+
+static enum I2cLane ionopimax_i2c_lane(uint8_t reg) {
+	// watchdog, power and UPS registers
+	if ((reg >= 29 && reg <= 32) || (reg >= 36 && reg <= 39)
+			|| (reg >= 43 && reg <= 48)) {
+		return I2C_LANE_CRITICAL;
+	}
+	return I2C_LANE_BULK;
+}
+
+/*
+ * Takes the bus if free. Bulk transactions also give way to any waiting
+ * critical one.
+ */
+static bool ionopimax_i2c_lane_take(struct ionopimax_i2c_data *data,
+		enum I2cLane lane) {
+	bool taken = false;
+
+	spin_lock(&data->laneLock);
+	if (!data->busy && (lane == I2C_LANE_CRITICAL
+			|| data->waiting[I2C_LANE_CRITICAL] == 0)) {
+		data->busy = true;
+		taken = true;
+	}
+	spin_unlock(&data->laneLock);
+	return taken;
+}
+
+static bool ionopimax_i2c_lock(enum I2cLane lane) {
+	struct ionopimax_i2c_data *data;
+	struct I2cLaneStats *stats;
+	ktime_t start;
+	u64 wait;
+	bool taken;
+
+	if (!ionopimax_i2c_client) {
+		return false;
+	}
+	data = i2c_get_clientdata(ionopimax_i2c_client);
+
+	start = ktime_get();
+	spin_lock(&data->laneLock);
+	data->waiting[lane]++;
+	spin_unlock(&data->laneLock);
+
+	taken = wait_event_timeout(data->laneQueue,
+			ionopimax_i2c_lane_take(data, lane),
+			msecs_to_jiffies(i2cLaneTimeout_ms[lane])) > 0;
+
+	wait = ktime_to_ns(ktime_sub(ktime_get(), start));
+	stats = &i2cLaneStats[lane];
+	spin_lock(&data->laneLock);
+	data->waiting[lane]--;
+	if (taken) {
+		stats->cnt++;
+		stats->waitTotal_nsec += wait;
+		if (wait > stats->waitMax_nsec) {
+			stats->waitMax_nsec = wait;
+		}
+	} else {
+		stats->timeoutCnt++;
+	}
+	spin_unlock(&data->laneLock);
+
+	if (!taken) {
+		// bulk waiters may have been held back by this one
+		wake_up_all(&data->laneQueue);
+	}
+	return taken;
+}
+
+static void ionopimax_i2c_unlock(void) {
+	struct ionopimax_i2c_data *data;
+	if (ionopimax_i2c_client) {
+		data = i2c_get_clientdata(ionopimax_i2c_client);
+		spin_lock(&data->laneLock);
+		data->busy = false;
+		spin_unlock(&data->laneLock);
+		wake_up_all(&data->laneQueue);
+	}
+}
+
+/*
+ * To be called between the transactions of a long bulk sequence: if a
+ * critical transaction is waiting, releases the bus and takes it back
+ * after it. Returns false if the bus could not be taken back.
+ */
+static bool ionopimax_i2c_yield(void) {
+	struct ionopimax_i2c_data *data;
+
+	if (!ionopimax_i2c_client) {
+		return false;
+	}
+	data = i2c_get_clientdata(ionopimax_i2c_client);
+	if (READ_ONCE(data->waiting[I2C_LANE_CRITICAL]) == 0) {
+		return true;
+	}
+	ionopimax_i2c_unlock();
+	return ionopimax_i2c_lock(I2C_LANE_BULK);
+}
+
+static void ionopimax_i2c_add_crc(int reg, char *data, uint8_t len) {
+	uint8_t r = reg;
+
+	data[len] = crc8Update(crc8Update(CRC8_INIT, &r, 1), data, len);
+}
+
+static int32_t ionopimax_i2c_read_no_lock(uint8_t reg, uint8_t len) {
+	int32_t res;
+	char buf[4];
+	uint8_t i;
+	uint8_t crc;
+
+	if (!ionopimax_i2c_client) {
+		return -EIO;
+	}
+
+	if (fwVerMajor > 1 || fwVerMinor >= 4) {
+		len++;
 	}
 
 	for (i = 0; i < 3; i++) {
@@ -3714,6 +2262,10 @@ static int32_t ionopimax_i2c_read_no_lock(uint8_t reg, uint8_t len) {
 		res |= (buf[i] & 0xff) << (i * 8);
 	}
 
+	if (len == 2) {
+		WRITE_ONCE(regShadow[reg], res);
+	}
+
 	return res;
 }
 
@@ -3726,6 +2278,10 @@ static int32_t ionopimax_i2c_write_no_lock(uint8_t reg, uint8_t len,
 		return -EIO;
 	}
 
+	WRITE_ONCE(regCache[reg], -ENODATA);
+	WRITE_ONCE(regShadow[reg], -ENODATA);
+	regWriteGen[reg]++;
+
 	for (i = 0; i < len; i++) {
 		buf[i] = val >> (8 * i);
 	}
@@ -3743,30 +2299,79 @@ static int32_t ionopimax_i2c_write_no_lock(uint8_t reg, uint8_t len,
 }
 
 static int32_t ionopimax_i2c_read(uint8_t reg, uint8_t len) {
+	struct I2cFlight *f;
+	unsigned long gen;
+	unsigned int val;
+	bool share;
 	int32_t res;
 
 	if (len < 2) {
 		return -EINVAL;
 	}
 
-	if (!ionopimax_i2c_lock()) {
-		return -EBUSY;
+	if (len == 2 && ionopimax_regmap_cached(reg)) {
+		res = regmap_read(ionopimaxRegmap, reg, &val);
+		if (res < 0) {
+			return res;
+		}
+		return val;
 	}
 
-	res = ionopimax_i2c_read_no_lock(reg, len);
-
-	ionopimax_i2c_unlock();
+	if (READ_ONCE(regCacheLen[reg]) == len) {
+		res = READ_ONCE(regCache[reg]);
+		if (res >= 0) {
+			WRITE_ONCE(regCacheHitCnt, regCacheHitCnt + 1);
+			return res;
+		}
+	}
+	WRITE_ONCE(regCacheMissCnt, regCacheMissCnt + 1);
+
+	f = &i2cFlights[reg];
+	spin_lock(&i2cFlightLock);
+	while (f->active) {
+		// read already on the bus: share its result if of the same length,
+		// else wait for it to end before starting ours
+		share = f->len == len;
+		gen = f->gen;
+		spin_unlock(&i2cFlightLock);
+		wait_event(i2cFlightQueue, READ_ONCE(f->gen) != gen);
+		spin_lock(&i2cFlightLock);
+		if (share && f->resLen == len) {
+			res = f->res;
+			i2cFlightCoalescedCnt++;
+			spin_unlock(&i2cFlightLock);
+			return res;
+		}
+	}
+	f->active = true;
+	f->len = len;
+	spin_unlock(&i2cFlightLock);
 
-	if (res < 0) {
-		return -EIO;
+	if (!ionopimax_i2c_lock(ionopimax_i2c_lane(reg))) {
+		res = -EBUSY;
+	} else {
+		res = ionopimax_i2c_read_no_lock(reg, len);
+		ionopimax_i2c_unlock();
+		if (res < 0) {
+			res = -EIO;
+		}
 	}
+
+	spin_lock(&i2cFlightLock);
+	f->res = res;
+	f->resLen = len;
+	f->gen++;
+	f->active = false;
+	spin_unlock(&i2cFlightLock);
+	wake_up_all(&i2cFlightQueue);
+
 	return res;
 }
 
 static int32_t ionopimax_i2c_write(uint8_t reg, uint8_t len, uint32_t val) {
 	int32_t res;
 
-	if (!ionopimax_i2c_lock()) {
+	if (!ionopimax_i2c_lock(ionopimax_i2c_lane(reg))) {
 		return -EBUSY;
 	}
 
@@ -3774,6 +2379,9 @@ static int32_t ionopimax_i2c_write(uint8_t reg, uint8_t len, uint32_t val) {
 
 	ionopimax_i2c_unlock();
 
+	// written behind the map's back
+	ionopimax_regmap_drop(reg, reg);
+
 	if (res < 0) {
 		return -EIO;
 	}
@@ -3790,56 +2398,297 @@ static int32_t ionopimax_i2c_read_segment(uint8_t reg, uint8_t len,
 	return (res >> shift) & mask;
 }
 
+static int32_t ionopimax_write_check(struct WriteVerify *wv, int32_t res) {
+	uint32_t val;
+
+	if (res < 0) {
+		return res;
+	}
+	val = wv->val;
+	if (wv->maskedReg) {
+		res &= wv->mask;
+		val &= wv->mask;
+	}
+	return res == val ? 0 : -EPERM;
+}
+
+static int32_t ionopimax_write_verify_no_lock(struct WriteVerify *wv) {
+	return ionopimax_write_check(wv, ionopimax_i2c_read_no_lock(wv->reg, 2));
+}
+
+/*
+ * Writes a 16-bit register and reads it back in a single i2c_transfer(),
+ * joined by repeated starts: no STOP/START and no other transaction on
+ * the bus between the two.
+ */
+static int32_t ionopimax_i2c_write_read_no_lock(uint8_t reg, uint32_t val) {
+	struct i2c_msg msgs[3];
+	u8 wbuf[4];
+	u8 rbuf[3];
+	bool hasCrc;
+	uint8_t i;
+	uint8_t crc;
+	int ret = -EIO;
+
+	hasCrc = fwVerMajor > 1 || fwVerMinor >= 4;
+
+	WRITE_ONCE(regCache[reg], -ENODATA);
+	WRITE_ONCE(regShadow[reg], -ENODATA);
+	regWriteGen[reg]++;
+
+	wbuf[0] = reg;
+	wbuf[1] = val;
+	wbuf[2] = val >> 8;
+	if (hasCrc) {
+		ionopimax_i2c_add_crc(reg, wbuf + 1, 2);
+	}
+
+	msgs[0].addr = ionopimax_i2c_client->addr;
+	msgs[0].flags = 0;
+	msgs[0].len = hasCrc ? 4 : 3;
+	msgs[0].buf = wbuf;
+	msgs[1].addr = ionopimax_i2c_client->addr;
+	msgs[1].flags = 0;
+	msgs[1].len = 1;
+	msgs[1].buf = wbuf;
+	msgs[2].addr = ionopimax_i2c_client->addr;
+	msgs[2].flags = I2C_M_RD;
+	msgs[2].len = hasCrc ? 3 : 2;
+	msgs[2].buf = rbuf;
+
+	for (i = 0; i < 3; i++) {
+		ret = i2c_transfer(ionopimax_i2c_client->adapter, msgs, 3);
+		if (ret == 3) {
+			if (!hasCrc) {
+				break;
+			}
+			crc = rbuf[2];
+			ionopimax_i2c_add_crc(reg, rbuf, 2);
+			if (crc == rbuf[2]) {
+				break;
+			}
+			ret = -EIO;
+		}
+	}
+
+	if (ret != 3) {
+		WRITE_ONCE(i2cCombinedErrCnt, i2cCombinedErrCnt + 1);
+		return -EIO;
+	}
+
+	WRITE_ONCE(i2cCombinedCnt, i2cCombinedCnt + 1);
+	ret = rbuf[0] | (rbuf[1] << 8);
+	WRITE_ONCE(regShadow[reg], ret);
+	return ret;
+}
+
+/*
+ * Write and immediate read back, combined in one transfer when possible.
+ * Falls back to separate SMBus calls if the combined transfer fails or
+ * reads back a different value, and stops trying it after
+ * I2C_COMBINED_MAX_FAILS failures in a row.
+ */
+static int32_t ionopimax_i2c_write_verified_no_lock(struct WriteVerify *wv) {
+	int32_t res;
+
+	if (READ_ONCE(i2cCombined)) {
+		res = ionopimax_i2c_write_read_no_lock(wv->reg, wv->val);
+		if (res >= 0) {
+			if (ionopimax_write_check(wv, res) == 0) {
+				i2cCombinedFails = 0;
+				return 0;
+			}
+			WRITE_ONCE(i2cCombinedErrCnt, i2cCombinedErrCnt + 1);
+		}
+		if (++i2cCombinedFails >= I2C_COMBINED_MAX_FAILS) {
+			pr_warn(LOG_TAG "combined write/read not working, disabled\n");
+			WRITE_ONCE(i2cCombined, false);
+		}
+	}
+
+	res = ionopimax_i2c_write_no_lock(wv->reg, 2, wv->val);
+	if (res < 0) {
+		return res;
+	}
+	return ionopimax_write_verify_no_lock(wv);
+}
+
+static void ionopimax_write_verify_work(struct work_struct *work) {
+	struct WriteVerify wv;
+	struct device *dev;
+	int32_t res;
+
+	while (kfifo_out_spinlocked(&writeVerifyQueue, &wv, 1, &writeVerifyLock)) {
+		if (!ionopimax_i2c_lock(ionopimax_i2c_lane(wv.reg))) {
+			res = -EBUSY;
+		} else if (wv.gen != regWriteGen[wv.reg]) {
+			// superseded by a newer write
+			ionopimax_i2c_unlock();
+			continue;
+		} else {
+			res = ionopimax_write_verify_no_lock(&wv);
+			ionopimax_i2c_unlock();
+		}
+		if (res == 0) {
+			continue;
+		}
+		pr_warn(LOG_TAG "write verify failed reg=%u\n", wv.reg);
+		WRITE_ONCE(regShadow[wv.reg], -ENODATA);
+		ionopimax_regmap_drop(wv.reg, wv.reg);
+		WRITE_ONCE(writeVerifyErrCnt, writeVerifyErrCnt + 1);
+		dev = ionopimax_get_device(devAttrBeansMcu);
+		if (dev != NULL) {
+			sysfs_notify(&dev->kobj, NULL, "write_verify_err_cnt");
+		}
+	}
+}
+
+static DECLARE_WORK(writeVerifyWork, ionopimax_write_verify_work);
+
+static void ionopimax_write_verify_kick(void) {
+	spin_lock(&writeVerifyLock);
+	if (writeVerifyStarted) {
+		queue_work(ionopimaxWq, &writeVerifyWork);
+	}
+	spin_unlock(&writeVerifyLock);
+}
+
+static void ionopimax_write_verify_start(void) {
+	spin_lock(&writeVerifyLock);
+	kfifo_reset(&writeVerifyQueue);
+	writeVerifyStarted = true;
+	spin_unlock(&writeVerifyLock);
+}
+
+static void ionopimax_write_verify_stop(void) {
+	spin_lock(&writeVerifyLock);
+	writeVerifyStarted = false;
+	spin_unlock(&writeVerifyLock);
+	cancel_work_sync(&writeVerifyWork);
+}
+
+static enum WritePolicy ionopimax_write_policy(void) {
+	if (fwVerMajor > 1 || fwVerMinor >= 4) {
+		return READ_ONCE(writePolicy);
+	}
+	// no CRC on the bus: always read back
+	return WRITE_POLICY_VERIFY;
+}
+
+/*
+ * Writes a register as required by the write policy. Called holding the
+ * bus; *deferred is set if the read back was queued to writeVerifyWork.
+ */
+static int32_t ionopimax_i2c_write_policy_no_lock(struct WriteVerify *wv,
+		bool *deferred) {
+	enum WritePolicy policy;
+	int32_t res;
+
+	policy = ionopimax_write_policy();
+	if (policy == WRITE_POLICY_VERIFY_DEFERRED
+			&& READ_ONCE(writeVerifyStarted)
+			&& !kfifo_is_full(&writeVerifyQueue)) {
+		// only writers, all holding the bus, add to the queue
+		res = ionopimax_i2c_write_no_lock(wv->reg, 2, wv->val);
+		if (res >= 0) {
+			wv->gen = regWriteGen[wv->reg];
+			kfifo_in_spinlocked(&writeVerifyQueue, wv, 1, &writeVerifyLock);
+			*deferred = true;
+		}
+		return res;
+	}
+	if (policy == WRITE_POLICY_TRUST_CRC) {
+		return ionopimax_i2c_write_no_lock(wv->reg, 2, wv->val);
+	}
+	// verify now, also when the deferred queue is full
+	return ionopimax_i2c_write_verified_no_lock(wv);
+}
+
+/*
+ * Bit field write on a cached register: the rest of the register comes
+ * from the cache and the write is always sent, even if the cache already
+ * holds the same value.
+ */
+static int32_t ionopimax_regmap_update(uint8_t reg, uint16_t mask,
+		uint16_t val) {
+	int res;
+
+	res = regmap_write_bits(ionopimaxRegmap, reg, mask, val);
+	if (res < 0) {
+		// the map updates its cache before sending the value
+		ionopimax_regmap_drop(reg, reg);
+		return res;
+	}
+	set_bit(reg, regmapWritten);
+	return 0;
+}
+
 static int32_t ionopimax_i2c_write_segment(uint8_t reg, bool maskedReg,
 		uint32_t mask, uint8_t shift, uint32_t val) {
+	struct WriteVerify wv;
+	enum WritePolicy policy;
+	bool deferred = false;
 	int32_t res = 0;
 
-	if (!ionopimax_i2c_lock()) {
+	if (!maskedReg && ionopimax_regmap_cached(reg)) {
+		return ionopimax_regmap_update(reg, mask << shift,
+				(val & mask) << shift);
+	}
+
+	if (!ionopimax_i2c_lock(ionopimax_i2c_lane(reg))) {
 		return -EBUSY;
 	}
 
+	policy = ionopimax_write_policy();
+
 	val = (val & mask) << shift;
 	mask <<= shift;
 
 	if (maskedReg) {
 		val = (mask << 8) | val;
 	} else if (mask != 0xffff) {
-		res = ionopimax_i2c_read_no_lock(reg, 2);
+		res = -ENODATA;
+		if (policy != WRITE_POLICY_VERIFY
+				&& !ionopimax_reg_mcu_changed(reg)) {
+			res = READ_ONCE(regShadow[reg]);
+		}
+		if (res < 0) {
+			res = ionopimax_i2c_read_no_lock(reg, 2);
+		}
 		val = (res & ~mask) | val;
 	}
 
 	if (res >= 0) {
-		res = ionopimax_i2c_write_no_lock(reg, 2, val);
-		if (res >= 0) {
-			res = ionopimax_i2c_read_no_lock(reg, 2);
-			if (res >= 0) {
-				if (maskedReg) {
-					res &= mask;
-					val &= mask;
-				}
-				if (res != val) {
-					res = -EPERM;
-				}
-			}
+		wv.reg = reg;
+		wv.maskedReg = maskedReg;
+		wv.mask = mask;
+		wv.val = val;
+		res = ionopimax_i2c_write_policy_no_lock(&wv, &deferred);
+		if (res >= 0 && !maskedReg) {
+			WRITE_ONCE(regShadow[reg], val);
 		}
 	}
 
 	ionopimax_i2c_unlock();
 
+	if (deferred) {
+		ionopimax_write_verify_kick();
+	}
+
 	return res;
 }
 
 static ssize_t devAttrI2c_show(struct device *dev,
 		struct device_attribute *attr, char *buf) {
 	int32_t res;
-	struct DeviceAttrRegSpecs *specs;
+	const struct DeviceAttrRegSpecs *specs;
 	struct DeviceAttrBean *dab;
 	dab = container_of(attr, struct DeviceAttrBean, devAttr);
 	if (dab == NULL) {
 		return -EFAULT;
 	}
-	specs = &dab->regSpecs;
-	if (specs->reg == 0) {
+	specs = dab->regSpecs;
+	if (specs == NULL) {
 		return -EFAULT;
 	}
 
@@ -3880,16 +2729,16 @@ static ssize_t devAttrI2c_store(struct device *dev,
 	uint16_t i;
 	int32_t res;
 	char valC;
-	struct DeviceAttrRegSpecs *specs;
+	const struct DeviceAttrRegSpecs *specs;
 	struct DeviceAttrBean *dab;
 	dab = container_of(attr, struct DeviceAttrBean, devAttr);
 	if (dab == NULL) {
 		return -EFAULT;
 	}
-	specs = &dab->regSpecsStore;
-	if (specs->reg == 0) {
-		specs = &dab->regSpecs;
-		if (specs->reg == 0) {
+	specs = dab->regSpecsStore;
+	if (specs == NULL) {
+		specs = dab->regSpecs;
+		if (specs == NULL) {
 			return -EFAULT;
 		}
 	}
@@ -3931,14 +2780,14 @@ static ssize_t devAttrI2c_store(struct device *dev,
 static ssize_t devAttrAxMode_show(struct device *dev,
 		struct device_attribute *attr, char *buf) {
 	int32_t res;
-	struct DeviceAttrRegSpecs *specs;
+	const struct DeviceAttrRegSpecs *specs;
 	struct DeviceAttrBean *dab;
 	dab = container_of(attr, struct DeviceAttrBean, devAttr);
 	if (dab == NULL) {
 		return -EFAULT;
 	}
-	specs = &dab->regSpecs;
-	if (specs->reg == 0) {
+	specs = dab->regSpecs;
+	if (specs == NULL) {
 		return -EFAULT;
 	}
 
@@ -3974,14 +2823,14 @@ static ssize_t devAttrAxMode_store(struct device *dev,
 	int32_t res;
 	char valC;
 	uint16_t en, mode;
-	struct DeviceAttrRegSpecs *specs;
+	const struct DeviceAttrRegSpecs *specs;
 	struct DeviceAttrBean *dab;
 	dab = container_of(attr, struct DeviceAttrBean, devAttr);
 	if (dab == NULL) {
 		return -EFAULT;
 	}
-	specs = &dab->regSpecs;
-	if (specs->reg == 0) {
+	specs = dab->regSpecs;
+	if (specs == NULL) {
 		return -EFAULT;
 	}
 
@@ -4069,14 +2918,14 @@ static ssize_t devAttrUpsBatteryV_store(struct device *dev,
 static ssize_t devAttrSdEnabled_show(struct device *dev,
 		struct device_attribute *attr, char *buf) {
 	int32_t res;
-	struct DeviceAttrRegSpecs *specs;
+	const struct DeviceAttrRegSpecs *specs;
 	struct DeviceAttrBean *dab;
 	dab = container_of(attr, struct DeviceAttrBean, devAttr);
 	if (dab == NULL) {
 		return -EFAULT;
 	}
-	specs = &dab->regSpecs;
-	if (specs->reg == 0) {
+	specs = dab->regSpecs;
+	if (specs == NULL) {
 		return -EFAULT;
 	}
 
@@ -4111,16 +2960,16 @@ static ssize_t devAttrSdEnabled_store(struct device *dev,
 	long val;
 	int ret;
 	int32_t res;
-	struct DeviceAttrRegSpecs *specs;
+	const struct DeviceAttrRegSpecs *specs;
 	struct DeviceAttrBean *dab;
 	dab = container_of(attr, struct DeviceAttrBean, devAttr);
 	if (dab == NULL) {
 		return -EFAULT;
 	}
-	specs = &dab->regSpecsStore;
-	if (specs->reg == 0) {
-		specs = &dab->regSpecs;
-		if (specs->reg == 0) {
+	specs = dab->regSpecsStore;
+	if (specs == NULL) {
+		specs = dab->regSpecs;
+		if (specs == NULL) {
 			return -EFAULT;
 		}
 	}
@@ -4199,6 +3048,11 @@ static ssize_t devAttrMcuConfig_store(struct device *dev,
 	if (res < 0) {
 		return res;
 	}
+	// the MCU rewrites its registers on restore
+	ionopimax_shadow_invalidate_all();
+	if (cmd == 'R') {
+		bitmap_zero(regmapWritten, REG_CACHE_SIZE);
+	}
 
 	for (i = 0; i < 10; i++) {
 		msleep(50);
@@ -4221,10 +3075,171 @@ static ssize_t devAttrMcuConfig_store(struct device *dev,
 
 static int32_t mcuI2cReadVal;
 
-static ssize_t mcuI2cRead_show(struct device *dev,
-		struct device_attribute *attr, char *buf) {
-	return sprintf(buf, "0x%04x\n", mcuI2cReadVal);
-}
+static int ionopimax_i2c_lane_get(struct device_attribute *attr) {
+	int lane;
+	size_t len;
+
+	for (lane = 0; lane < I2C_LANE_SIZE; lane++) {
+		len = strlen(i2cLaneNames[lane]);
+		if (strncmp(attr->attr.name, "i2c_", 4) == 0
+				&& strncmp(attr->attr.name + 4, i2cLaneNames[lane], len) == 0
+				&& attr->attr.name[4 + len] == '_') {
+			return lane;
+		}
+	}
+	return -1;
+}
+
+static ssize_t devAttrI2cLaneStats_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct ionopimax_i2c_data *data;
+	struct I2cLaneStats stats;
+	const char *field;
+	int lane;
+
+	lane = ionopimax_i2c_lane_get(attr);
+	if (lane < 0 || !ionopimax_i2c_client) {
+		return -EFAULT;
+	}
+	data = i2c_get_clientdata(ionopimax_i2c_client);
+	spin_lock(&data->laneLock);
+	stats = i2cLaneStats[lane];
+	spin_unlock(&data->laneLock);
+
+	field = attr->attr.name + 5 + strlen(i2cLaneNames[lane]);
+	if (strcmp(field, "cnt") == 0) {
+		return sprintf(buf, "%lu\n", stats.cnt);
+	}
+	if (strcmp(field, "timeout_cnt") == 0) {
+		return sprintf(buf, "%lu\n", stats.timeoutCnt);
+	}
+	if (strcmp(field, "wait_avg_us") == 0) {
+		return sprintf(buf, "%llu\n", stats.cnt == 0 ? 0 :
+				div_u64(div64_u64(stats.waitTotal_nsec, stats.cnt),
+						NSEC_PER_USEC));
+	}
+	if (strcmp(field, "wait_max_us") == 0) {
+		return sprintf(buf, "%llu\n",
+				div_u64(stats.waitMax_nsec, NSEC_PER_USEC));
+	}
+	return -EFAULT;
+}
+
+static ssize_t devAttrI2cLaneStats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct ionopimax_i2c_data *data;
+	int lane;
+
+	lane = ionopimax_i2c_lane_get(attr);
+	if (lane < 0 || !ionopimax_i2c_client) {
+		return -EFAULT;
+	}
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+	data = i2c_get_clientdata(ionopimax_i2c_client);
+	spin_lock(&data->laneLock);
+	memset(&i2cLaneStats[lane], 0, sizeof(struct I2cLaneStats));
+	spin_unlock(&data->laneLock);
+	return count;
+}
+
+static ssize_t devAttrMcuWritePolicy_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%s\n", writePolicyNames[READ_ONCE(writePolicy)]);
+}
+
+static ssize_t devAttrMcuWritePolicy_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int i;
+
+	for (i = 0; i < WRITE_POLICY_SIZE; i++) {
+		if (sysfs_streq(buf, writePolicyNames[i])) {
+			break;
+		}
+	}
+	if (i == WRITE_POLICY_SIZE) {
+		return -EINVAL;
+	}
+	if (i != WRITE_POLICY_VERIFY && fwVerMajor <= 1 && fwVerMinor < 4) {
+		// no CRC protection on this firmware
+		return -EOPNOTSUPP;
+	}
+	WRITE_ONCE(writePolicy, i);
+	return count;
+}
+
+static ssize_t devAttrMcuWriteVerifyErrCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(writeVerifyErrCnt));
+}
+
+static ssize_t devAttrMcuI2cCombined_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%d\n", READ_ONCE(i2cCombined) ? 1 : 0);
+}
+
+static ssize_t devAttrMcuI2cCombined_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	bool val;
+
+	ret = kstrtobool(buf, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val && (!ionopimax_i2c_client || !i2c_check_functionality(
+			ionopimax_i2c_client->adapter, I2C_FUNC_I2C))) {
+		return -EOPNOTSUPP;
+	}
+	i2cCombinedFails = 0;
+	WRITE_ONCE(i2cCombined, val);
+	return count;
+}
+
+static ssize_t devAttrMcuI2cCombinedCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(i2cCombinedCnt));
+}
+
+static ssize_t devAttrMcuI2cCombinedErrCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(i2cCombinedErrCnt));
+}
+
+static ssize_t devAttrMcuCacheSync_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	bool val;
+	unsigned int reg;
+
+	ret = kstrtobool(buf, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (!val) {
+		return -EINVAL;
+	}
+	if (ionopimaxRegmap == NULL) {
+		return -ENODEV;
+	}
+
+	// only what was written, the rest is as the MCU loaded it
+	regcache_mark_dirty(ionopimaxRegmap);
+	for_each_set_bit(reg, regmapWritten, REG_CACHE_SIZE) {
+		ret = regcache_sync_region(ionopimaxRegmap, reg, reg);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return count;
+}
+
+static ssize_t mcuI2cRead_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "0x%04x\n", mcuI2cReadVal);
+}
 
 static ssize_t mcuI2cRead_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count) {
@@ -4342,100 +3357,2356 @@ static ssize_t devAttrSerialRs232Rs485Inv_store(struct device *dev,
 	uint16_t regVal;
 	char regStr[6];
 
-	baud = simple_strtol(buf, &end, 10);
-	if (buf == end) {
-		return -EINVAL;
+	baud = simple_strtol(buf, &end, 10);
+	if (buf == end) {
+		return -EINVAL;
+	}
+
+	switch (baud) {
+	case 0:
+		case 1:
+		regVal = baud;
+		break;
+	case 1200:
+		regVal = 2;
+		break;
+	case 2400:
+		regVal = 3;
+		break;
+	case 4800:
+		regVal = 4;
+		break;
+	case 9600:
+		regVal = 5;
+		break;
+	case 19200:
+		regVal = 6;
+		break;
+	case 38400:
+		regVal = 7;
+		break;
+	case 57600:
+		regVal = 8;
+		break;
+	case 115200:
+		regVal = 9;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (regVal > 1) {
+		if (end + 4 > buf + count) {
+			return -EINVAL;
+		}
+
+		regVal <<= 8;
+		regVal |= 0x3;
+
+		switch (end[1]) {
+		case '7':
+			break;
+		case '8':
+			regVal |= 0x4000;
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		switch (end[2]) {
+		case 'n':
+			case 'N':
+			break;
+		case 'o':
+			case 'O':
+			regVal |= 0x1000;
+			break;
+		case 'e':
+			case 'E':
+			regVal |= 0x2000;
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		switch (end[3]) {
+		case '1':
+			break;
+		case '2':
+			regVal |= 0x8000;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	ret = sprintf(regStr, "%d", regVal);
+	if (ret < 1) {
+		return ret;
+	}
+
+	ret = devAttrI2c_store(dev, attr, regStr, ret);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return count;
+}
+
+static bool nowayout = WATCHDOG_NOWAYOUT;
+module_param(nowayout, bool, 0);
+MODULE_PARM_DESC(nowayout, "Watchdog cannot be stopped once started (default="
+		__MODULE_STRING(WATCHDOG_NOWAYOUT) ")");
+
+static bool wdtAlwaysEnabled = false;
+static bool wdtRegistered = false;
+
+static int ionopimax_wdt_start(struct watchdog_device *wdd) {
+	gpioSetVal(&gpioWdEn, 1);
+	return 0;
+}
+
+static int ionopimax_wdt_stop(struct watchdog_device *wdd) {
+	gpioSetVal(&gpioWdEn, 0);
+	if (wdtAlwaysEnabled) {
+		// enable_mode A, the MCU ignores the enable line: keep pinging
+		set_bit(WDOG_HW_RUNNING, &wdd->status);
+	}
+	return 0;
+}
+
+static int ionopimax_wdt_ping(struct watchdog_device *wdd) {
+	// any transition of the heartbeat line restarts the MCU timeout
+	gpioSetVal(&gpioWdHeartbeat, gpioGetVal(&gpioWdHeartbeat) ? 0 : 1);
+	return 0;
+}
+
+static int ionopimax_wdt_set_timeout(struct watchdog_device *wdd,
+		unsigned int timeout) {
+	int32_t res;
+
+	res = ionopimax_i2c_write_segment(30, false, 0xffff, 0, timeout);
+	if (res < 0) {
+		return res;
+	}
+	wdd->timeout = timeout;
+
+	return 0;
+}
+
+static const struct watchdog_info ionopimax_wdt_info = {
+	.options = WDIOF_SETTIMEOUT | WDIOF_KEEPALIVEPING | WDIOF_MAGICCLOSE,
+	.identity = "Iono Pi Max MCU watchdog",
+};
+
+static const struct watchdog_ops ionopimax_wdt_ops = {
+	.owner = THIS_MODULE,
+	.start = ionopimax_wdt_start,
+	.stop = ionopimax_wdt_stop,
+	.ping = ionopimax_wdt_ping,
+	.set_timeout = ionopimax_wdt_set_timeout,
+};
+
+static struct watchdog_device wdtDevice = {
+	.info = &ionopimax_wdt_info,
+	.ops = &ionopimax_wdt_ops,
+	.min_timeout = 1,
+	.max_timeout = 0xffff,
+	.timeout = 60,
+};
+
+/*
+ * Registers the MCU watchdog with the watchdog framework. Timeout and enable
+ * mode are taken from the MCU; when always enabled, the watchdog core
+ * generates the heartbeat until /dev/watchdog is opened.
+ */
+static int ionopimax_wdt_register(struct platform_device *pdev) {
+	int32_t res;
+
+	wdtDevice.parent = &pdev->dev;
+
+	res = ionopimax_i2c_read(30, 2);
+	if (res > 0) {
+		wdtDevice.timeout = res;
+	}
+
+	res = ionopimax_i2c_read(29, 2);
+	wdtAlwaysEnabled = res == 1;
+	if (wdtAlwaysEnabled) {
+		set_bit(WDOG_HW_RUNNING, &wdtDevice.status);
+	}
+
+	watchdog_set_nowayout(&wdtDevice, nowayout);
+	watchdog_stop_on_unregister(&wdtDevice);
+
+	res = watchdog_register_device(&wdtDevice);
+	if (res) {
+		return res;
+	}
+	wdtRegistered = true;
+
+	return 0;
+}
+
+#define UPS_POLL_INTERVAL_MS 1000
+
+#define UPS_STATUS_IDLE 0
+#define UPS_STATUS_DETECTING 1
+#define UPS_STATUS_NO_BATTERY 2
+#define UPS_STATUS_CHARGING 4
+#define UPS_STATUS_CHARGED 5
+#define UPS_STATUS_BATTERY 6
+#define UPS_STATUS_OVERVOLTAGE 8
+#define UPS_STATUS_UNDERVOLTAGE 9
+#define UPS_STATUS_CHARGER_DAMAGED 10
+#define UPS_STATUS_UNSTABLE 11
+
+struct UpsState {
+	bool valid;
+	bool onBattery;
+	uint8_t status;
+	uint8_t charge;
+	uint16_t capacity;
+	uint16_t chargerV;
+	uint16_t chargerI;
+	uint16_t powerInV;
+	uint16_t powerInI;
+};
+
+static struct delayed_work upsPollWork;
+static DEFINE_MUTEX(upsStateLock);
+static struct UpsState upsState;
+static struct power_supply *psyMains = NULL;
+static struct power_supply *psyBattery = NULL;
+
+static unsigned int upsShutdownCharge = 0;
+static unsigned int upsShutdownTime_sec = 0;
+static bool upsOnBattery = false;
+static unsigned long upsOnBatterySince;
+static bool upsShutdownStarted = false;
+
+static char *psyMainsSuppliedTo[] = { "ionopimax-battery" };
+
+static enum power_supply_property psyMainsProps[] = {
+	POWER_SUPPLY_PROP_ONLINE,
+	POWER_SUPPLY_PROP_VOLTAGE_NOW,
+	POWER_SUPPLY_PROP_CURRENT_NOW,
+};
+
+static enum power_supply_property psyBatteryProps[] = {
+	POWER_SUPPLY_PROP_STATUS,
+	POWER_SUPPLY_PROP_PRESENT,
+	POWER_SUPPLY_PROP_HEALTH,
+	POWER_SUPPLY_PROP_CAPACITY,
+	POWER_SUPPLY_PROP_VOLTAGE_NOW,
+	POWER_SUPPLY_PROP_CURRENT_NOW,
+	POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN,
+	POWER_SUPPLY_PROP_SCOPE,
+};
+
+static int ionopimax_ups_read(struct UpsState *st) {
+	int32_t res;
+
+	res = ionopimax_i2c_read(48, 2);
+	if (res < 0) {
+		return res;
+	}
+	st->status = res & 0xf;
+	st->onBattery = (res >> 7) & 1;
+	st->charge = (res >> 8) & 0xff;
+
+	res = ionopimax_i2c_read(44, 2);
+	if (res < 0) {
+		return res;
+	}
+	st->capacity = res;
+
+	res = ionopimax_i2c_read(147, 2);
+	if (res < 0) {
+		return res;
+	}
+	st->chargerV = res;
+
+	res = ionopimax_i2c_read(148, 2);
+	if (res < 0) {
+		return res;
+	}
+	st->chargerI = res;
+
+	res = ionopimax_i2c_read(145, 2);
+	if (res < 0) {
+		return res;
+	}
+	st->powerInV = res;
+
+	res = ionopimax_i2c_read(146, 2);
+	if (res < 0) {
+		return res;
+	}
+	st->powerInI = res;
+
+	st->valid = true;
+
+	return 0;
+}
+
+static void ionopimax_ups_get(struct UpsState *st) {
+	mutex_lock(&upsStateLock);
+	*st = upsState;
+	mutex_unlock(&upsStateLock);
+}
+
+/*
+ * Low-battery policy: when running on battery and either the charge drops
+ * to shutdown_charge or the time on battery reaches shutdown_time, enable
+ * the delayed power cycle, so that the system restarts once main power is
+ * back, and shut down.
+ */
+static void ionopimax_ups_policy(const struct UpsState *st) {
+	bool lowCharge, timeout;
+
+	if (!st->onBattery) {
+		upsOnBattery = false;
+		return;
+	}
+
+	if (!upsOnBattery) {
+		upsOnBattery = true;
+		upsOnBatterySince = jiffies;
+	}
+
+	if (upsShutdownStarted) {
+		return;
+	}
+
+	lowCharge = upsShutdownCharge > 0 && st->charge <= upsShutdownCharge;
+	timeout = upsShutdownTime_sec > 0
+			&& time_after_eq(jiffies,
+					upsOnBatterySince + upsShutdownTime_sec * HZ);
+
+	if (lowCharge || timeout) {
+		upsShutdownStarted = true;
+		pr_emerg(LOG_TAG "%s, shutting down\n",
+				lowCharge ? "battery charge low" : "on battery for too long");
+		gpioSetVal(&gpioPwrDnwEn, 1);
+		orderly_poweroff(true);
+	}
+}
+
+/*
+ * Refreshes the UPS state cache served to the power_supply class and
+ * signals changes of the reported state, not of the measurements.
+ */
+static void ionopimax_ups_poll(struct work_struct *work) {
+	struct UpsState st = { 0 };
+	struct UpsState prev;
+
+	if (ionopimax_ups_read(&st) == 0) {
+		mutex_lock(&upsStateLock);
+		prev = upsState;
+		upsState = st;
+		mutex_unlock(&upsStateLock);
+
+		ionopimax_ups_policy(&st);
+
+		if (psyMains != NULL
+				&& (!prev.valid || prev.onBattery != st.onBattery)) {
+			power_supply_changed(psyMains);
+		}
+		if (psyBattery != NULL
+				&& (!prev.valid || prev.onBattery != st.onBattery
+						|| prev.status != st.status
+						|| prev.charge != st.charge)) {
+			power_supply_changed(psyBattery);
+		}
+	}
+
+	queue_delayed_work(ionopimaxWq, &upsPollWork,
+			msecs_to_jiffies(UPS_POLL_INTERVAL_MS));
+}
+
+static ssize_t devAttrUpsShutdownCharge_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", upsShutdownCharge);
+}
+
+static ssize_t devAttrUpsShutdownCharge_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val > 100) {
+		return -EINVAL;
+	}
+
+	upsShutdownCharge = val;
+
+	return count;
+}
+
+static ssize_t devAttrUpsShutdownTime_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", upsShutdownTime_sec);
+}
+
+static ssize_t devAttrUpsShutdownTime_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val > 0xffff) {
+		return -EINVAL;
+	}
+
+	upsShutdownTime_sec = val;
+
+	return count;
+}
+
+static int ionopimax_psy_status(const struct UpsState *st) {
+	switch (st->status) {
+	case UPS_STATUS_CHARGING:
+		return POWER_SUPPLY_STATUS_CHARGING;
+	case UPS_STATUS_CHARGED:
+		return POWER_SUPPLY_STATUS_FULL;
+	case UPS_STATUS_BATTERY:
+		return POWER_SUPPLY_STATUS_DISCHARGING;
+	case UPS_STATUS_IDLE:
+	case UPS_STATUS_OVERVOLTAGE:
+	case UPS_STATUS_UNDERVOLTAGE:
+	case UPS_STATUS_CHARGER_DAMAGED:
+	case UPS_STATUS_UNSTABLE:
+		return st->onBattery ?
+				POWER_SUPPLY_STATUS_DISCHARGING :
+				POWER_SUPPLY_STATUS_NOT_CHARGING;
+	default:
+		return POWER_SUPPLY_STATUS_UNKNOWN;
+	}
+}
+
+static int ionopimax_psy_health(const struct UpsState *st) {
+	switch (st->status) {
+	case UPS_STATUS_DETECTING:
+	case UPS_STATUS_NO_BATTERY:
+		return POWER_SUPPLY_HEALTH_UNKNOWN;
+	case UPS_STATUS_OVERVOLTAGE:
+		return POWER_SUPPLY_HEALTH_OVERVOLTAGE;
+	case UPS_STATUS_UNDERVOLTAGE:
+		return POWER_SUPPLY_HEALTH_DEAD;
+	case UPS_STATUS_CHARGER_DAMAGED:
+	case UPS_STATUS_UNSTABLE:
+		return POWER_SUPPLY_HEALTH_UNSPEC_FAILURE;
+	default:
+		return POWER_SUPPLY_HEALTH_GOOD;
+	}
+}
+
+static int ionopimax_psy_mains_get(struct power_supply *psy,
+		enum power_supply_property psp, union power_supply_propval *val) {
+	struct UpsState st;
+
+	ionopimax_ups_get(&st);
+	if (!st.valid) {
+		return -ENODATA;
+	}
+
+	switch (psp) {
+	case POWER_SUPPLY_PROP_ONLINE:
+		val->intval = !st.onBattery;
+		break;
+	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+		val->intval = st.powerInV * 1000;
+		break;
+	case POWER_SUPPLY_PROP_CURRENT_NOW:
+		val->intval = st.powerInI * 1000;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int ionopimax_psy_battery_get(struct power_supply *psy,
+		enum power_supply_property psp, union power_supply_propval *val) {
+	struct UpsState st;
+
+	ionopimax_ups_get(&st);
+	if (!st.valid) {
+		return -ENODATA;
+	}
+
+	switch (psp) {
+	case POWER_SUPPLY_PROP_STATUS:
+		val->intval = ionopimax_psy_status(&st);
+		break;
+	case POWER_SUPPLY_PROP_PRESENT:
+		val->intval = st.status != UPS_STATUS_NO_BATTERY;
+		break;
+	case POWER_SUPPLY_PROP_HEALTH:
+		val->intval = ionopimax_psy_health(&st);
+		break;
+	case POWER_SUPPLY_PROP_CAPACITY:
+		val->intval = st.charge;
+		break;
+	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+		val->intval = st.chargerV * 1000;
+		break;
+	case POWER_SUPPLY_PROP_CURRENT_NOW:
+		val->intval = st.chargerI * 1000;
+		break;
+	case POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN:
+		val->intval = st.capacity * 1000;
+		break;
+	case POWER_SUPPLY_PROP_SCOPE:
+		val->intval = POWER_SUPPLY_SCOPE_SYSTEM;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct power_supply_desc psyMainsDesc = {
+	.name = "ionopimax-mains",
+	.type = POWER_SUPPLY_TYPE_MAINS,
+	.properties = psyMainsProps,
+	.num_properties = ARRAY_SIZE(psyMainsProps),
+	.get_property = ionopimax_psy_mains_get,
+};
+
+static const struct power_supply_desc psyBatteryDesc = {
+	.name = "ionopimax-battery",
+	.type = POWER_SUPPLY_TYPE_BATTERY,
+	.properties = psyBatteryProps,
+	.num_properties = ARRAY_SIZE(psyBatteryProps),
+	.get_property = ionopimax_psy_battery_get,
+};
+
+static int ionopimax_psy_register(struct platform_device *pdev) {
+	struct power_supply_config mainsCfg = {
+		.supplied_to = psyMainsSuppliedTo,
+		.num_supplicants = ARRAY_SIZE(psyMainsSuppliedTo),
+	};
+	struct power_supply_config batteryCfg = { };
+	struct power_supply *psy;
+
+	INIT_DELAYED_WORK(&upsPollWork, ionopimax_ups_poll);
+
+	// fill the cache before the first uevent
+	ionopimax_ups_read(&upsState);
+
+	psy = power_supply_register(&pdev->dev, &psyMainsDesc, &mainsCfg);
+	if (IS_ERR(psy)) {
+		return PTR_ERR(psy);
+	}
+	psyMains = psy;
+
+	psy = power_supply_register(&pdev->dev, &psyBatteryDesc, &batteryCfg);
+	if (IS_ERR(psy)) {
+		return PTR_ERR(psy);
+	}
+	psyBattery = psy;
+
+	queue_delayed_work(ionopimaxWq, &upsPollWork,
+			msecs_to_jiffies(UPS_POLL_INTERVAL_MS));
+
+	return 0;
+}
+
+static void ionopimax_psy_unregister(void) {
+	if (psyBattery != NULL || psyMains != NULL) {
+		cancel_delayed_work_sync(&upsPollWork);
+	}
+	if (psyBattery != NULL) {
+		power_supply_unregister(psyBattery);
+		psyBattery = NULL;
+	}
+	if (psyMains != NULL) {
+		power_supply_unregister(psyMains);
+		psyMains = NULL;
+	}
+}
+
+#define SYS_STATE_REG 140
+#define SYS_STATE_POLL_INTERVAL_MIN_MS 10
+
+static unsigned int sysStatePollInterval_ms = 1000;
+static struct device *sysStateDevice = NULL;
+// the poll work is only queued, holding the lock, while started
+static DEFINE_SPINLOCK(sysStatePollLock);
+static bool sysStatePollStarted = false;
+static int32_t sysStateLast = -1;
+
+/*
+ * Notifies pollers of the sys_state attributes mapped on the changed bits
+ * and emits a change uevent carrying the new value and the changed mask.
+ */
+static void ionopimax_sys_state_notify(uint16_t val, uint16_t changed) {
+	struct DeviceAttrBean *dab;
+	char envVal[24];
+	char envChanged[32];
+	char *envp[] = { envVal, envChanged, NULL };
+	int ai;
+
+	ai = 0;
+	while (devAttrBeansSysState[ai].devAttr.attr.name != NULL) {
+		dab = &devAttrBeansSysState[ai];
+		if (dab->regSpecs != NULL && dab->regSpecs->reg == SYS_STATE_REG
+				&& ((dab->regSpecs->mask << dab->regSpecs->shift) & changed)) {
+			sysfs_notify(&sysStateDevice->kobj, NULL, dab->devAttr.attr.name);
+		}
+		ai++;
+	}
+
+	snprintf(envVal, sizeof(envVal), "SYS_STATE=0x%04x", val);
+	snprintf(envChanged, sizeof(envChanged), "SYS_STATE_CHANGED=0x%04x",
+			changed);
+	kobject_uevent_env(&sysStateDevice->kobj, KOBJ_CHANGE, envp);
+}
+
+static void ionopimax_sys_state_poll(struct work_struct *work) {
+	int32_t res;
+	unsigned int interval;
+
+	res = ionopimax_i2c_read(SYS_STATE_REG, 2);
+	if (res >= 0) {
+		if (sysStateLast >= 0 && res != sysStateLast) {
+			// protections may have changed config registers bits
+			ionopimax_shadow_invalidate_all();
+			ionopimax_sys_state_notify(res, res ^ sysStateLast);
+		}
+		sysStateLast = res;
+	}
+
+	spin_lock(&sysStatePollLock);
+	interval = READ_ONCE(sysStatePollInterval_ms);
+	if (sysStatePollStarted && interval > 0) {
+		queue_delayed_work(ionopimaxWq, to_delayed_work(work),
+				msecs_to_jiffies(interval));
+	}
+	spin_unlock(&sysStatePollLock);
+}
+
+static DECLARE_DELAYED_WORK(sysStatePollWork, ionopimax_sys_state_poll);
+
+static void ionopimax_sys_state_start(struct device *dev) {
+	sysStateDevice = dev;
+	spin_lock(&sysStatePollLock);
+	sysStatePollStarted = true;
+	if (sysStatePollInterval_ms > 0) {
+		queue_delayed_work(ionopimaxWq, &sysStatePollWork, 0);
+	}
+	spin_unlock(&sysStatePollLock);
+}
+
+static void ionopimax_sys_state_stop(void) {
+	spin_lock(&sysStatePollLock);
+	sysStatePollStarted = false;
+	spin_unlock(&sysStatePollLock);
+	cancel_delayed_work_sync(&sysStatePollWork);
+	sysStateDevice = NULL;
+}
+
+static ssize_t devAttrSysStatePollInterval_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", sysStatePollInterval_ms);
+}
+
+static ssize_t devAttrSysStatePollInterval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val > 0 && val < SYS_STATE_POLL_INTERVAL_MIN_MS) {
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(sysStatePollInterval_ms, val);
+	cancel_delayed_work_sync(&sysStatePollWork);
+	spin_lock(&sysStatePollLock);
+	if (val > 0 && sysStatePollStarted) {
+		queue_delayed_work(ionopimaxWq, &sysStatePollWork, 0);
+	}
+	spin_unlock(&sysStatePollLock);
+
+	return count;
+}
+
+#define ANALOG_POLL_INTERVAL_MIN_MS 10
+#define ALARM_EVENTS_QUEUE_SIZE 64
+
+#define ALARM_NONE 0
+#define ALARM_LOW 1
+#define ALARM_HIGH 2
+
+static const char VALS_ALARM[] = { 3, '0', 'L', 'H' };
+
+/*
+ * Record returned by read() on /dev/ionopimax_alarms, one per change of
+ * the alarm state of a channel.
+ */
+struct AlarmEvent {
+	uint64_t ts;
+	char channel[32];
+	int32_t value;
+	int32_t alarm;
+};
+
+struct AnalogChannel {
+	const char *name;
+	struct DeviceAttrBean *devAttrBeans;
+	// of the attribute named after the channel in devAttrBeans
+	const struct DeviceAttrRegSpecs *regSpecs;
+	struct device *dev;
+	int32_t deadband;
+	int32_t lastNotified;
+	bool lastValid;
+	bool alarmEnabled;
+	bool alarmLowSet;
+	bool alarmHighSet;
+	bool alarmLatch;
+	int32_t alarmLow;
+	int32_t alarmHigh;
+	int32_t alarmHyst;
+	uint8_t alarmCond;
+	uint8_t alarm;
+	bool alarmAcked;
+	int32_t val;
+};
+
+static struct AnalogChannel analogChannels[] = {
+	{ .name = "av1", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "av2", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "av3", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "av4", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "ai1", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "ai2", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "ai3", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "ai4", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "at1", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "at2", .devAttrBeans = devAttrBeansAnalogIn },
+	{ .name = "mon_v", .devAttrBeans = devAttrBeansPwrIn },
+	{ .name = "mon_i", .devAttrBeans = devAttrBeansPwrIn },
+	{ .name = "charger_mon_v", .devAttrBeans = devAttrBeansUps },
+	{ .name = "charger_mon_i", .devAttrBeans = devAttrBeansUps },
+	{ .name = "vso_mon_v", .devAttrBeans = devAttrBeansPowerOut },
+	{ .name = "vso_mon_i", .devAttrBeans = devAttrBeansPowerOut },
+	{ }
+};
+
+static DEFINE_MUTEX(analogLock);
+static DEFINE_KFIFO(alarmEvents, struct AlarmEvent, ALARM_EVENTS_QUEUE_SIZE);
+static DECLARE_WAIT_QUEUE_HEAD(alarmReadQueue);
+static DEFINE_MUTEX(alarmReadLock);
+static bool alarmMiscDevRegistered = false;
+
+static unsigned int analogPollInterval_ms = 100;
+// the poll work is only queued, holding the lock, while started
+static DEFINE_SPINLOCK(analogPollLock);
+static bool analogPollStarted = false;
+
+static struct AnalogChannel *ionopimax_analog_get(struct device *dev,
+		struct device_attribute *attr) {
+	struct AnalogChannel *ch;
+	size_t len;
+
+	for (ch = analogChannels; ch->name != NULL; ch++) {
+		len = strlen(ch->name);
+		if (ch->dev == dev && strncmp(ch->name, attr->attr.name, len) == 0
+				&& attr->attr.name[len] == '_') {
+			return ch;
+		}
+	}
+	return NULL;
+}
+
+static int ionopimax_analog_read(struct AnalogChannel *ch, int32_t *val) {
+	const struct DeviceAttrRegSpecs *specs = ch->regSpecs;
+	int32_t res;
+
+	res = ionopimax_i2c_read_segment(specs->reg, specs->len, specs->mask,
+			specs->shift);
+	if (res < 0) {
+		return res;
+	}
+
+	if (specs->sign) {
+		if (specs->len == 3) {
+			if ((res & 0x800000) == 0x800000) {
+				res |= 0xff000000;
+			}
+		} else {
+			res = (int16_t) res;
+		}
+	}
+	*val = res;
+
+	return 0;
+}
+
+static bool ionopimax_analog_active(struct AnalogChannel *ch) {
+	return ch->dev != NULL && (ch->deadband > 0 || ch->alarmEnabled);
+}
+
+/*
+ * Queues an alarm event and notifies the pollers of <ch>_alarm.
+ * Must be called with analogLock held.
+ */
+static void ionopimax_alarm_event(struct AnalogChannel *ch) {
+	struct AlarmEvent ev;
+	char name[32];
+
+	memset(&ev, 0, sizeof(ev));
+	ev.ts = ktime_get_real_ns();
+	snprintf(ev.channel, sizeof(ev.channel), "%s/%s", dev_name(ch->dev),
+			ch->name);
+	ev.value = ch->val;
+	ev.alarm = ch->alarm;
+
+	if (!kfifo_put(&alarmEvents, ev)) {
+		pr_warn_ratelimited(LOG_TAG "alarm events queue full, event dropped\n");
+	}
+	wake_up_interruptible(&alarmReadQueue);
+
+	snprintf(name, sizeof(name), "%s_alarm", ch->name);
+	sysfs_notify(&ch->dev->kobj, NULL, name);
+}
+
+/*
+ * Updates the alarm state of the channel with a new sample. A low (high)
+ * alarm is raised when the value goes below (above) the threshold and
+ * cleared when it gets back above (below) it by the hysteresis. Latched
+ * alarms are kept until acknowledged. Must be called with analogLock held.
+ */
+static void ionopimax_alarm_eval(struct AnalogChannel *ch) {
+	uint8_t cond;
+	uint8_t alarm;
+
+	cond = ch->alarmCond;
+	if (cond == ALARM_LOW
+			&& (int64_t) ch->val >= (int64_t) ch->alarmLow + ch->alarmHyst) {
+		cond = ALARM_NONE;
+	} else if (cond == ALARM_HIGH
+			&& (int64_t) ch->val <= (int64_t) ch->alarmHigh - ch->alarmHyst) {
+		cond = ALARM_NONE;
+	}
+	if (cond == ALARM_NONE) {
+		if (ch->alarmLowSet && ch->val < ch->alarmLow) {
+			cond = ALARM_LOW;
+		} else if (ch->alarmHighSet && ch->val > ch->alarmHigh) {
+			cond = ALARM_HIGH;
+		}
+	}
+
+	if (cond != ALARM_NONE && ch->alarmCond == ALARM_NONE) {
+		ch->alarmAcked = false;
+	}
+	ch->alarmCond = cond;
+
+	if (cond != ALARM_NONE) {
+		alarm = cond;
+	} else if (ch->alarmLatch && !ch->alarmAcked) {
+		alarm = ch->alarm;
+	} else {
+		alarm = ALARM_NONE;
+	}
+
+	if (alarm != ch->alarm) {
+		ch->alarm = alarm;
+		ionopimax_alarm_event(ch);
+	}
+}
+
+/*
+ * Samples the channels with a deadband or an alarm set. Pollers of the
+ * channel are notified when the value moved by at least the deadband from
+ * the last notified one.
+ */
+static void ionopimax_analog_poll(struct work_struct *work) {
+	struct AnalogChannel *ch;
+	unsigned int interval;
+	int32_t val;
+
+	for (ch = analogChannels; ch->name != NULL; ch++) {
+		if (!ionopimax_analog_active(ch)) {
+			continue;
+		}
+		if (ionopimax_analog_read(ch, &val)) {
+			continue;
+		}
+
+		mutex_lock(&analogLock);
+		ch->val = val;
+		if (ch->deadband > 0) {
+			if (!ch->lastValid) {
+				ch->lastNotified = val;
+				ch->lastValid = true;
+			} else if (abs(val - ch->lastNotified) >= ch->deadband) {
+				ch->lastNotified = val;
+				sysfs_notify(&ch->dev->kobj, NULL, ch->name);
+			}
+		}
+		if (ch->alarmEnabled) {
+			ionopimax_alarm_eval(ch);
+		}
+		mutex_unlock(&analogLock);
+	}
+
+	spin_lock(&analogPollLock);
+	interval = READ_ONCE(analogPollInterval_ms);
+	if (analogPollStarted && interval > 0) {
+		queue_delayed_work(ionopimaxWq, to_delayed_work(work),
+				msecs_to_jiffies(interval));
+	}
+	spin_unlock(&analogPollLock);
+}
+
+static DECLARE_DELAYED_WORK(analogPollWork, ionopimax_analog_poll);
+
+static void ionopimax_analog_kick(void) {
+	spin_lock(&analogPollLock);
+	if (analogPollStarted && analogPollInterval_ms > 0) {
+		mod_delayed_work(ionopimaxWq, &analogPollWork, 0);
+	}
+	spin_unlock(&analogPollLock);
+}
+
+static const struct DeviceAttrRegSpecs *ionopimax_analog_specs(
+		struct AnalogChannel *ch) {
+	struct DeviceAttrBean *dab;
+
+	for (dab = ch->devAttrBeans; dab->devAttr.attr.name != NULL; dab++) {
+		if (strcmp(dab->devAttr.attr.name, ch->name) == 0) {
+			return dab->regSpecs;
+		}
+	}
+	return NULL;
+}
+
+static void ionopimax_analog_set_device(struct DeviceBean *db) {
+	struct AnalogChannel *ch;
+
+	for (ch = analogChannels; ch->name != NULL; ch++) {
+		if (ch->devAttrBeans != db->devAttrBeans) {
+			continue;
+		}
+		ch->regSpecs = ionopimax_analog_specs(ch);
+		if (ch->regSpecs == NULL) {
+			pr_err(LOG_TAG "no register for analog channel %s\n", ch->name);
+			continue;
+		}
+		ch->dev = db->pDevice;
+	}
+}
+
+static void ionopimax_analog_start(void) {
+	spin_lock(&analogPollLock);
+	analogPollStarted = true;
+	if (analogPollInterval_ms > 0) {
+		queue_delayed_work(ionopimaxWq, &analogPollWork, 0);
+	}
+	spin_unlock(&analogPollLock);
+}
+
+static void ionopimax_analog_stop(void) {
+	struct AnalogChannel *ch;
+
+	spin_lock(&analogPollLock);
+	analogPollStarted = false;
+	spin_unlock(&analogPollLock);
+	cancel_delayed_work_sync(&analogPollWork);
+	for (ch = analogChannels; ch->name != NULL; ch++) {
+		ch->dev = NULL;
+	}
+}
+
+static ssize_t devAttrAnalogPollInterval_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", analogPollInterval_ms);
+}
+
+static ssize_t devAttrAnalogPollInterval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val > 0 && val < ANALOG_POLL_INTERVAL_MIN_MS) {
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(analogPollInterval_ms, val);
+	cancel_delayed_work_sync(&analogPollWork);
+	spin_lock(&analogPollLock);
+	if (val > 0 && analogPollStarted) {
+		queue_delayed_work(ionopimaxWq, &analogPollWork, 0);
+	}
+	spin_unlock(&analogPollLock);
+
+	return count;
+}
+
+static ssize_t devAttrAnalogDeadband_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct AnalogChannel *ch;
+
+	ch = ionopimax_analog_get(dev, attr);
+	if (ch == NULL) {
+		return -EFAULT;
+	}
+
+	return sprintf(buf, "%d\n", ch->deadband);
+}
+
+static ssize_t devAttrAnalogDeadband_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct AnalogChannel *ch;
+	int ret;
+	int val;
+
+	ch = ionopimax_analog_get(dev, attr);
+	if (ch == NULL) {
+		return -EFAULT;
+	}
+
+	ret = kstrtoint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val < 0) {
+		return -EINVAL;
+	}
+
+	// the next sample becomes the new reference
+	mutex_lock(&analogLock);
+	ch->lastValid = false;
+	ch->deadband = val;
+	mutex_unlock(&analogLock);
+
+	ionopimax_analog_kick();
+
+	return count;
+}
+
+static int ionopimax_alarm_threshold_parse(const char *tok, bool *set,
+		int32_t *val) {
+	if (strcmp(tok, "-") == 0) {
+		*set = false;
+		return 0;
+	}
+	*set = true;
+	return kstrtoint(tok, 10, val);
+}
+
+static ssize_t devAttrAnalogAlarmCfg_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct AnalogChannel *ch;
+	char low[12], high[12];
+
+	ch = ionopimax_analog_get(dev, attr);
+	if (ch == NULL) {
+		return -EFAULT;
+	}
+
+	if (!ch->alarmEnabled) {
+		return sprintf(buf, "off\n");
+	}
+
+	strcpy(low, "-");
+	strcpy(high, "-");
+	if (ch->alarmLowSet) {
+		sprintf(low, "%d", ch->alarmLow);
+	}
+	if (ch->alarmHighSet) {
+		sprintf(high, "%d", ch->alarmHigh);
+	}
+
+	return sprintf(buf, "%s %s %d %d\n", low, high, ch->alarmHyst,
+			ch->alarmLatch ? 1 : 0);
+}
+
+static ssize_t devAttrAnalogAlarmCfg_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct AnalogChannel *ch;
+	char lowTok[12], highTok[12];
+	bool lowSet, highSet, latch;
+	int32_t low = 0, high = 0, hyst;
+	int latchVal;
+
+	ch = ionopimax_analog_get(dev, attr);
+	if (ch == NULL) {
+		return -EFAULT;
+	}
+
+	if (strncmp(buf, "off", 3) == 0) {
+		mutex_lock(&analogLock);
+		ch->alarmEnabled = false;
+		ch->alarmCond = ALARM_NONE;
+		if (ch->alarm != ALARM_NONE) {
+			ch->alarm = ALARM_NONE;
+			ionopimax_alarm_event(ch);
+		}
+		mutex_unlock(&analogLock);
+		return count;
+	}
+
+	if (sscanf(buf, "%11s %11s %d %d", lowTok, highTok, &hyst, &latchVal)
+			!= 4) {
+		return -EINVAL;
+	}
+	if (ionopimax_alarm_threshold_parse(lowTok, &lowSet, &low)
+			|| ionopimax_alarm_threshold_parse(highTok, &highSet, &high)) {
+		return -EINVAL;
+	}
+	if ((!lowSet && !highSet) || hyst < 0 || (latchVal != 0 && latchVal != 1)
+			|| (lowSet && highSet && low > high)) {
+		return -EINVAL;
+	}
+	latch = latchVal == 1;
+
+	mutex_lock(&analogLock);
+	ch->alarmLowSet = lowSet;
+	ch->alarmLow = low;
+	ch->alarmHighSet = highSet;
+	ch->alarmHigh = high;
+	ch->alarmHyst = hyst;
+	ch->alarmLatch = latch;
+	ch->alarmCond = ALARM_NONE;
+	ch->alarmEnabled = true;
+	mutex_unlock(&analogLock);
+
+	ionopimax_analog_kick();
+
+	return count;
+}
+
+static ssize_t devAttrAnalogAlarm_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct AnalogChannel *ch;
+
+	ch = ionopimax_analog_get(dev, attr);
+	if (ch == NULL) {
+		return -EFAULT;
+	}
+
+	return sprintf(buf, "%c\n", VALS_ALARM[ch->alarm + 1]);
+}
+
+static ssize_t devAttrAnalogAlarm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct AnalogChannel *ch;
+
+	ch = ionopimax_analog_get(dev, attr);
+	if (ch == NULL) {
+		return -EFAULT;
+	}
+
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+
+	mutex_lock(&analogLock);
+	ch->alarmAcked = true;
+	if (ch->alarmCond == ALARM_NONE && ch->alarm != ALARM_NONE) {
+		ch->alarm = ALARM_NONE;
+		ionopimax_alarm_event(ch);
+	}
+	mutex_unlock(&analogLock);
+
+	return count;
+}
+
+static ssize_t ionopimax_alarms_read(struct file *file, char __user *buf,
+		size_t count, loff_t *ppos) {
+	unsigned int copied;
+	int ret;
+
+	if (count < sizeof(struct AlarmEvent)) {
+		return -EINVAL;
+	}
+
+	if (mutex_lock_interruptible(&alarmReadLock)) {
+		return -ERESTARTSYS;
+	}
+
+	while (kfifo_is_empty(&alarmEvents)) {
+		mutex_unlock(&alarmReadLock);
+		if (file->f_flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		ret = wait_event_interruptible(alarmReadQueue,
+				!kfifo_is_empty(&alarmEvents));
+		if (ret) {
+			return ret;
+		}
+		if (mutex_lock_interruptible(&alarmReadLock)) {
+			return -ERESTARTSYS;
+		}
+	}
+
+	ret = kfifo_to_user(&alarmEvents, buf, count, &copied);
+
+	mutex_unlock(&alarmReadLock);
+
+	if (ret) {
+		return ret;
+	}
+	return copied;
+}
+
+static __poll_t ionopimax_alarms_poll(struct file *file, poll_table *wait) {
+	poll_wait(file, &alarmReadQueue, wait);
+
+	if (!kfifo_is_empty(&alarmEvents)) {
+		return EPOLLIN | EPOLLRDNORM;
+	}
+	return 0;
+}
+
+static const struct file_operations ionopimax_alarms_fops = {
+	.owner = THIS_MODULE,
+	.read = ionopimax_alarms_read,
+	.poll = ionopimax_alarms_poll,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice alarmMiscDev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "ionopimax_alarms",
+	.fops = &ionopimax_alarms_fops,
+	.mode = 0440,
+};
+
+#define OUT_FAULT_POLL_INTERVAL_MIN_MS 10
+#define OUT_RELAYS_STATUS_REG 85
+#define OUT_OC_STATUS_REG 90
+#define OUT_STATUS_FAULT_OPEN 2
+#define OUT_STATUS_FAULT_CLOSED 3
+
+struct OutFault {
+	const char *name;
+	uint8_t reg;
+	uint8_t shift;
+	int8_t status;
+	unsigned long cnt;
+	uint64_t ts;
+};
+
+static struct OutFault outFaults[] = {
+	{ .name = "o1", .reg = OUT_RELAYS_STATUS_REG, .shift = 0, .status = -1 },
+	{ .name = "o2", .reg = OUT_RELAYS_STATUS_REG, .shift = 2, .status = -1 },
+	{ .name = "o3", .reg = OUT_RELAYS_STATUS_REG, .shift = 4, .status = -1 },
+	{ .name = "o4", .reg = OUT_RELAYS_STATUS_REG, .shift = 6, .status = -1 },
+	{ .name = "oc1", .reg = OUT_OC_STATUS_REG, .shift = 0, .status = -1 },
+	{ .name = "oc2", .reg = OUT_OC_STATUS_REG, .shift = 2, .status = -1 },
+	{ .name = "oc3", .reg = OUT_OC_STATUS_REG, .shift = 4, .status = -1 },
+	{ .name = "oc4", .reg = OUT_OC_STATUS_REG, .shift = 6, .status = -1 },
+	{ }
+};
+
+static unsigned int outFaultPollInterval_ms = 200;
+static struct device *outFaultDevice = NULL;
+// the poll work is only queued, holding the lock, while started
+static DEFINE_SPINLOCK(outFaultPollLock);
+static bool outFaultPollStarted = false;
+
+static inline bool ionopimax_out_is_fault(int status) {
+	return status == OUT_STATUS_FAULT_OPEN || status == OUT_STATUS_FAULT_CLOSED;
+}
+
+static struct OutFault *ionopimax_out_fault_get(struct device_attribute *attr) {
+	struct OutFault *of;
+	size_t len;
+
+	for (of = outFaults; of->name != NULL; of++) {
+		len = strlen(of->name);
+		if (strncmp(of->name, attr->attr.name, len) == 0
+				&& attr->attr.name[len] == '_') {
+			return of;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Reads the relays and OC status registers and notifies pollers of o<n>
+ * and oc<n> when an output enters, leaves or changes fault state.
+ */
+static void ionopimax_out_fault_poll(struct work_struct *work) {
+	struct OutFault *of;
+	int32_t relaysVal, ocVal, res;
+	int status;
+	unsigned int interval;
+
+	relaysVal = ionopimax_i2c_read(OUT_RELAYS_STATUS_REG, 2);
+	ocVal = ionopimax_i2c_read(OUT_OC_STATUS_REG, 2);
+
+	for (of = outFaults; of->name != NULL; of++) {
+		res = of->reg == OUT_RELAYS_STATUS_REG ? relaysVal : ocVal;
+		if (res < 0) {
+			continue;
+		}
+		status = (res >> of->shift) & 0b11;
+		if (ionopimax_out_is_fault(status) && status != of->status) {
+			WRITE_ONCE(of->ts, ktime_get_real_ns());
+			if (!ionopimax_out_is_fault(of->status)) {
+				WRITE_ONCE(of->cnt, of->cnt + 1);
+			}
+		}
+		if (of->status >= 0 && status != of->status
+				&& (ionopimax_out_is_fault(status)
+						|| ionopimax_out_is_fault(of->status))) {
+			sysfs_notify(&outFaultDevice->kobj, NULL, of->name);
+		}
+		of->status = status;
+	}
+
+	spin_lock(&outFaultPollLock);
+	interval = READ_ONCE(outFaultPollInterval_ms);
+	if (outFaultPollStarted && interval > 0) {
+		queue_delayed_work(ionopimaxWq, to_delayed_work(work),
+				msecs_to_jiffies(interval));
+	}
+	spin_unlock(&outFaultPollLock);
+}
+
+static DECLARE_DELAYED_WORK(outFaultPollWork, ionopimax_out_fault_poll);
+
+static void ionopimax_out_fault_start(struct device *dev) {
+	outFaultDevice = dev;
+	spin_lock(&outFaultPollLock);
+	outFaultPollStarted = true;
+	if (outFaultPollInterval_ms > 0) {
+		queue_delayed_work(ionopimaxWq, &outFaultPollWork, 0);
+	}
+	spin_unlock(&outFaultPollLock);
+}
+
+static void ionopimax_out_fault_stop(void) {
+	spin_lock(&outFaultPollLock);
+	outFaultPollStarted = false;
+	spin_unlock(&outFaultPollLock);
+	cancel_delayed_work_sync(&outFaultPollWork);
+	outFaultDevice = NULL;
+}
+
+static ssize_t devAttrOutFaultPollInterval_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", outFaultPollInterval_ms);
+}
+
+static ssize_t devAttrOutFaultPollInterval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val > 0 && val < OUT_FAULT_POLL_INTERVAL_MIN_MS) {
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(outFaultPollInterval_ms, val);
+	cancel_delayed_work_sync(&outFaultPollWork);
+	spin_lock(&outFaultPollLock);
+	if (val > 0 && outFaultPollStarted) {
+		queue_delayed_work(ionopimaxWq, &outFaultPollWork, 0);
+	}
+	spin_unlock(&outFaultPollLock);
+
+	return count;
+}
+
+static ssize_t devAttrOutFaultCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct OutFault *of;
+
+	of = ionopimax_out_fault_get(attr);
+	if (of == NULL) {
+		return -EFAULT;
+	}
+	return sprintf(buf, "%lu\n", READ_ONCE(of->cnt));
+}
+
+static ssize_t devAttrOutFaultCnt_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct OutFault *of;
+
+	of = ionopimax_out_fault_get(attr);
+	if (of == NULL) {
+		return -EFAULT;
+	}
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+	WRITE_ONCE(of->cnt, 0);
+	return count;
+}
+
+static ssize_t devAttrOutFaultTs_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct OutFault *of;
+
+	of = ionopimax_out_fault_get(attr);
+	if (of == NULL) {
+		return -EFAULT;
+	}
+	return sprintf(buf, "%llu\n", READ_ONCE(of->ts));
+}
+
+#define SCAN_CYCLE_MIN_USEC 1000
+#define SCAN_CYCLE_MAX_USEC 1000000
+#define SCAN_OUTPUTS_OFFSET 256
+#define SCAN_DI_SIZE 4
+#define SCAN_DT_SIZE 4
+#define SCAN_AV_SIZE 4
+#define SCAN_AI_SIZE 4
+#define SCAN_AT_SIZE 2
+#define SCAN_O_SIZE 4
+#define SCAN_OC_SIZE 4
+#define SCAN_AO_SIZE 2
+#define SCAN_RELAYS_CMD_REG 84
+#define SCAN_OC_CMD_REG 89
+
+/*
+ * Input image, at offset 0 of the page mapped by mmap() on
+ * /dev/ionopimax_scan. Updated by the kernel at every cycle; seq is odd
+ * while an update is in progress.
+ */
+struct ScanInputImage {
+	uint32_t seq;
+	uint32_t cycle;
+	uint64_t ts;
+	uint8_t di[SCAN_DI_SIZE];
+	uint8_t dt[SCAN_DT_SIZE];
+	int32_t av[SCAN_AV_SIZE];
+	int32_t ai[SCAN_AI_SIZE];
+	int32_t at[SCAN_AT_SIZE];
+};
+
+/*
+ * Output image, at offset SCAN_OUTPUTS_OFFSET of the same page. Written
+ * by userspace, only the entries changed since the previous cycle are
+ * sent to the MCU.
+ */
+struct ScanOutputImage {
+	uint8_t o[SCAN_O_SIZE];
+	uint8_t oc[SCAN_OC_SIZE];
+	uint32_t ao[SCAN_AO_SIZE];
+};
+
+static const uint8_t scanAvRegs[SCAN_AV_SIZE] = { 71, 72, 73, 74 };
+static const uint8_t scanAiRegs[SCAN_AI_SIZE] = { 75, 76, 77, 78 };
+static const uint8_t scanAtRegs[SCAN_AT_SIZE] = { 79, 80 };
+static const uint8_t scanAoRegs[SCAN_AO_SIZE] = { 95, 100 };
+
+static void *scanImage = NULL;
+static struct ScanInputImage scanInLast;
+static struct ScanOutputImage scanOutLast;
+static struct task_struct *scanTask = NULL;
+static DEFINE_MUTEX(scanLock);
+// scanImage allocated and the module not being removed, under scanLock
+static bool scanReady = false;
+static DECLARE_WAIT_QUEUE_HEAD(scanWaitQueue);
+static bool scanMiscDevRegistered = false;
+
+static unsigned int scanCycle_usec = 10000;
+static unsigned long scanCycleCnt = 0;
+static unsigned long scanOverrunCnt = 0;
+static unsigned long scanErrCnt = 0;
+static u64 scanDuration_nsec = 0;
+static u64 scanDurationMax_nsec = 0;
+static u64 scanJitterMax_nsec = 0;
+
+static inline struct ScanInputImage *ionopimax_scan_inputs(void) {
+	return (struct ScanInputImage *) scanImage;
+}
+
+static inline struct ScanOutputImage *ionopimax_scan_outputs(void) {
+	return (struct ScanOutputImage *) (scanImage + SCAN_OUTPUTS_OFFSET);
+}
+
+static inline int32_t ionopimax_scan_sign24(int32_t val) {
+	if ((val & 0x800000) == 0x800000) {
+		val |= 0xff000000;
+	}
+	return val;
+}
+
+/*
+ * Reads DI and DT lines with a single gpiod array read. Lines currently
+ * not requested (e.g. DT in mode 'x') are reported as 0.
+ */
+static void ionopimax_scan_read_gpios(struct ScanInputImage *in) {
+	struct gpio_desc *descs[SCAN_DI_SIZE + SCAN_DT_SIZE];
+	struct GpioBean *beans[SCAN_DI_SIZE + SCAN_DT_SIZE];
+	DECLARE_BITMAP(vals, SCAN_DI_SIZE + SCAN_DT_SIZE);
+	uint8_t *dst[SCAN_DI_SIZE + SCAN_DT_SIZE];
+	struct gpio_desc *desc;
+	unsigned int n, i;
+
+	n = 0;
+	for (i = 0; i < SCAN_DI_SIZE + SCAN_DT_SIZE; i++) {
+		if (i < SCAN_DI_SIZE) {
+			beans[n] = &gpioDI[i].gpio;
+			dst[n] = &in->di[i];
+		} else {
+			beans[n] = &gpioDT[i - SCAN_DI_SIZE];
+			dst[n] = &in->dt[i - SCAN_DI_SIZE];
+		}
+		desc = READ_ONCE(beans[n]->desc);
+		if (desc == NULL || IS_ERR(desc)) {
+			*dst[n] = 0;
+			continue;
+		}
+		descs[n++] = desc;
+	}
+
+	if (n == 0) {
+		return;
+	}
+
+	if (gpiod_get_array_value(n, descs, NULL, vals)) {
+		scanErrCnt++;
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		*dst[i] = test_bit(i, vals) ? 1 : 0;
+		if (beans[i]->invert) {
+			*dst[i] = !*dst[i];
+		}
+	}
+}
+
+static void ionopimax_scan_read_regs(const uint8_t *regs, int32_t *vals,
+		int size) {
+	int32_t res;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		res = ionopimax_i2c_read_no_lock(regs[i], 3);
+		if (res < 0) {
+			scanErrCnt++;
+		} else {
+			vals[i] = ionopimax_scan_sign24(res);
+		}
+	}
+}
+
+static void ionopimax_scan_write_bits(uint8_t reg, const uint8_t *vals,
+		uint8_t *last, int size) {
+	uint32_t mask, bits;
+	int i;
+
+	mask = 0;
+	bits = 0;
+	for (i = 0; i < size; i++) {
+		if ((vals[i] != 0) != (last[i] != 0)) {
+			mask |= 1 << i;
+		}
+		if (vals[i] != 0) {
+			bits |= 1 << i;
+		}
+	}
+	if (mask == 0) {
+		return;
+	}
+
+	// masked register: only the bits in the high byte mask are changed
+	if (ionopimax_i2c_write_no_lock(reg, 2, (mask << 8) | (bits & mask)) < 0) {
+		scanErrCnt++;
+		return;
+	}
+	for (i = 0; i < size; i++) {
+		if (mask & (1 << i)) {
+			last[i] = vals[i] != 0;
+		}
+	}
+}
+
+/*
+ * One scan cycle: inputs are read and outputs written in a single bulk
+ * bus session, then the input image is published.
+ */
+static void ionopimax_scan_cycle(ktime_t ts) {
+	struct ScanInputImage *in = ionopimax_scan_inputs();
+	struct ScanOutputImage *out = ionopimax_scan_outputs();
+	struct ScanInputImage next;
+	struct ScanOutputImage cmd;
+	uint32_t val;
+	bool locked;
+	int i;
+
+	next = scanInLast;
+	for (i = 0; i < SCAN_O_SIZE; i++) {
+		cmd.o[i] = READ_ONCE(out->o[i]);
+	}
+	for (i = 0; i < SCAN_OC_SIZE; i++) {
+		cmd.oc[i] = READ_ONCE(out->oc[i]);
+	}
+	for (i = 0; i < SCAN_AO_SIZE; i++) {
+		cmd.ao[i] = READ_ONCE(out->ao[i]);
+	}
+
+	ionopimax_scan_read_gpios(&next);
+
+	// give way to critical transactions between the phases of the cycle
+	locked = ionopimax_i2c_lock(I2C_LANE_BULK);
+	if (locked) {
+		ionopimax_scan_read_regs(scanAvRegs, next.av, SCAN_AV_SIZE);
+		locked = ionopimax_i2c_yield();
+	}
+	if (locked) {
+		ionopimax_scan_read_regs(scanAiRegs, next.ai, SCAN_AI_SIZE);
+		locked = ionopimax_i2c_yield();
+	}
+	if (locked) {
+		ionopimax_scan_read_regs(scanAtRegs, next.at, SCAN_AT_SIZE);
+		locked = ionopimax_i2c_yield();
+	}
+	if (locked) {
+		ionopimax_scan_write_bits(SCAN_RELAYS_CMD_REG, cmd.o, scanOutLast.o,
+				SCAN_O_SIZE);
+		ionopimax_scan_write_bits(SCAN_OC_CMD_REG, cmd.oc, scanOutLast.oc,
+				SCAN_OC_SIZE);
+		for (i = 0; i < SCAN_AO_SIZE; i++) {
+			val = cmd.ao[i] & 0xffff;
+			if (val == scanOutLast.ao[i]) {
+				continue;
+			}
+			if (ionopimax_i2c_write_no_lock(scanAoRegs[i], 2, val) < 0) {
+				scanErrCnt++;
+			} else {
+				scanOutLast.ao[i] = val;
+			}
+		}
+
+		ionopimax_i2c_unlock();
+	} else {
+		scanErrCnt++;
+	}
+
+	next.ts = ktime_to_ns(ts);
+	next.cycle++;
+	scanInLast = next;
+
+	// the mapped page is writable by userspace: never read back from it
+	WRITE_ONCE(in->seq, ++scanInLast.seq);
+	smp_wmb();
+	memcpy(&in->cycle, &next.cycle,
+			sizeof(next) - offsetof(struct ScanInputImage, cycle));
+	smp_wmb();
+	WRITE_ONCE(in->seq, ++scanInLast.seq);
+
+	wake_up_interruptible(&scanWaitQueue);
+}
+
+/*
+ * Initializes the output image with the current state of the outputs so
+ * that nothing changes until userspace writes to it.
+ */
+static void ionopimax_scan_init_outputs(void) {
+	struct ScanOutputImage *out = ionopimax_scan_outputs();
+	int32_t res;
+	int i, st;
+
+	res = ionopimax_i2c_read(OUT_RELAYS_STATUS_REG, 2);
+	for (i = 0; i < SCAN_O_SIZE; i++) {
+		st = res < 0 ? 0 : (res >> (i * 2)) & 0b11;
+		scanOutLast.o[i] = st == 1 || st == OUT_STATUS_FAULT_CLOSED;
+		WRITE_ONCE(out->o[i], scanOutLast.o[i]);
+	}
+	res = ionopimax_i2c_read(OUT_OC_STATUS_REG, 2);
+	for (i = 0; i < SCAN_OC_SIZE; i++) {
+		st = res < 0 ? 0 : (res >> (i * 2)) & 0b11;
+		scanOutLast.oc[i] = st == 1 || st == OUT_STATUS_FAULT_CLOSED;
+		WRITE_ONCE(out->oc[i], scanOutLast.oc[i]);
+	}
+	for (i = 0; i < SCAN_AO_SIZE; i++) {
+		res = ionopimax_i2c_read(scanAoRegs[i], 2);
+		scanOutLast.ao[i] = res < 0 ? 0 : res & 0xffff;
+		WRITE_ONCE(out->ao[i], scanOutLast.ao[i]);
+	}
+}
+
+static int ionopimax_scan_thread(void *data) {
+	ktime_t next, start, now;
+	u64 jitter, duration;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+	sched_set_fifo(current);
+#endif
+
+	next = ktime_get();
+	while (!kthread_should_stop()) {
+		start = ktime_get();
+		jitter = ktime_to_ns(ktime_sub(start, next));
+		if (jitter > scanJitterMax_nsec) {
+			WRITE_ONCE(scanJitterMax_nsec, jitter);
+		}
+
+		ionopimax_scan_cycle(start);
+
+		now = ktime_get();
+		duration = ktime_to_ns(ktime_sub(now, start));
+		WRITE_ONCE(scanDuration_nsec, duration);
+		if (duration > scanDurationMax_nsec) {
+			WRITE_ONCE(scanDurationMax_nsec, duration);
+		}
+		WRITE_ONCE(scanCycleCnt, scanCycleCnt + 1);
+
+		next = ktime_add_us(next, READ_ONCE(scanCycle_usec));
+		if (!ktime_before(now, next)) {
+			// cycle time exceeded: skip the missed slots
+			WRITE_ONCE(scanOverrunCnt, scanOverrunCnt + 1);
+			next = now;
+			continue;
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop()) {
+			schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
+		}
+		__set_current_state(TASK_RUNNING);
+	}
+
+	return 0;
+}
+
+static int ionopimax_scan_start(void) {
+	struct task_struct *task;
+
+	if (!scanReady) {
+		return -ENODEV;
+	}
+	if (scanTask != NULL) {
+		return 0;
+	}
+
+	ionopimax_scan_init_outputs();
+
+	task = kthread_run(ionopimax_scan_thread, NULL, "ionopimax_scan");
+	if (IS_ERR(task)) {
+		return PTR_ERR(task);
+	}
+	scanTask = task;
+	return 0;
+}
+
+static void ionopimax_scan_stop(void) {
+	mutex_lock(&scanLock);
+	if (scanTask != NULL) {
+		kthread_stop(scanTask);
+		scanTask = NULL;
+	}
+	mutex_unlock(&scanLock);
+}
+
+static void ionopimax_scan_set_ready(bool ready) {
+	mutex_lock(&scanLock);
+	scanReady = ready;
+	mutex_unlock(&scanLock);
+}
+
+static int ionopimax_scan_open(struct inode *inode, struct file *file) {
+	// last cycle seen by this reader, for poll()
+	file->private_data = (void *) (uintptr_t) READ_ONCE(scanInLast.cycle);
+	return 0;
+}
+
+static __poll_t ionopimax_scan_poll(struct file *file, poll_table *wait) {
+	uint32_t cycle;
+
+	poll_wait(file, &scanWaitQueue, wait);
+
+	cycle = READ_ONCE(scanInLast.cycle);
+	if (cycle != (uint32_t) (uintptr_t) file->private_data) {
+		file->private_data = (void *) (uintptr_t) cycle;
+		return EPOLLIN | EPOLLRDNORM;
+	}
+	return 0;
+}
+
+static int ionopimax_scan_mmap(struct file *file, struct vm_area_struct *vma) {
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_SIZE) {
+		return -EINVAL;
+	}
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(scanImage));
+}
+
+static const struct file_operations ionopimax_scan_fops = {
+	.owner = THIS_MODULE,
+	.open = ionopimax_scan_open,
+	.poll = ionopimax_scan_poll,
+	.mmap = ionopimax_scan_mmap,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice scanMiscDev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "ionopimax_scan",
+	.fops = &ionopimax_scan_fops,
+	.mode = 0660,
+};
+
+static ssize_t devAttrScanEnabled_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%d\n", scanTask != NULL ? 1 : 0);
+}
+
+static ssize_t devAttrScanEnabled_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	bool enable;
+
+	ret = kstrtobool(buf, &enable);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (enable) {
+		mutex_lock(&scanLock);
+		ret = ionopimax_scan_start();
+		mutex_unlock(&scanLock);
+		if (ret < 0) {
+			return ret;
+		}
+	} else {
+		ionopimax_scan_stop();
+	}
+
+	return count;
+}
+
+static ssize_t devAttrScanCycle_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", scanCycle_usec);
+}
+
+static ssize_t devAttrScanCycle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val < SCAN_CYCLE_MIN_USEC || val > SCAN_CYCLE_MAX_USEC) {
+		return -EINVAL;
+	}
+	WRITE_ONCE(scanCycle_usec, val);
+	return count;
+}
+
+static ssize_t devAttrScanCycleCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(scanCycleCnt));
+}
+
+static ssize_t devAttrScanOverrunCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(scanOverrunCnt));
+}
+
+static ssize_t devAttrScanErrCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(scanErrCnt));
+}
+
+static ssize_t devAttrScanDuration_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%llu\n",
+			div_u64(READ_ONCE(scanDuration_nsec), NSEC_PER_USEC));
+}
+
+static ssize_t devAttrScanDurationMax_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%llu\n",
+			div_u64(READ_ONCE(scanDurationMax_nsec), NSEC_PER_USEC));
+}
+
+static ssize_t devAttrScanJitterMax_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%llu\n",
+			div_u64(READ_ONCE(scanJitterMax_nsec), NSEC_PER_USEC));
+}
+
+static ssize_t devAttrScanStats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	if (buf[0] != '0') {
+		return -EINVAL;
+	}
+	if (strcmp(attr->attr.name, "overrun_cnt") == 0) {
+		WRITE_ONCE(scanOverrunCnt, 0);
+	} else if (strcmp(attr->attr.name, "err_cnt") == 0) {
+		WRITE_ONCE(scanErrCnt, 0);
+	} else if (strcmp(attr->attr.name, "duration_max") == 0) {
+		WRITE_ONCE(scanDurationMax_nsec, 0);
+	} else if (strcmp(attr->attr.name, "jitter_max") == 0) {
+		WRITE_ONCE(scanJitterMax_nsec, 0);
+	} else {
+		return -EFAULT;
+	}
+	return count;
+}
+
+#define SCHED_BUS_BUDGET_DEFAULT 50
+#define SCHED_UTIL_WINDOW_NSEC NSEC_PER_SEC
+
+struct SchedRegGroup {
+	const char *name;
+	const uint8_t *regs;
+	uint8_t len;
+	unsigned int period_ms;
+	ktime_t release;
+	unsigned long lateCnt;
+};
+
+static const uint8_t schedAnalogRegs[] = { 71, 72, 73, 74, 75, 76, 77, 78, 79,
+		80, 0 };
+static const uint8_t schedMonitorsRegs[] = { 145, 146, 147, 148, 149, 150, 155,
+		156, 0 };
+/*
+ * UPS status (48) and system state (140) are left out: their monitors
+ * react to changes and must see the live value.
+ */
+static const uint8_t schedStatusRegs[] = { 96, 101, 0 };
+
+static struct SchedRegGroup schedGroups[] = {
+	{
+		.name = "analog",
+		.regs = schedAnalogRegs,
+		.len = 3,
+		.period_ms = 10,
+	},
+	{
+		.name = "monitors",
+		.regs = schedMonitorsRegs,
+		.len = 2,
+		.period_ms = 1000,
+	},
+	{
+		.name = "status",
+		.regs = schedStatusRegs,
+		.len = 2,
+		.period_ms = 5000,
+	},
+
+	{ }
+};
+
+static struct task_struct *schedTask = NULL;
+static unsigned int schedBusBudget = SCHED_BUS_BUDGET_DEFAULT;
+static unsigned int schedBusUtil = 0;
+
+static void ionopimax_sched_invalidate(struct SchedRegGroup *g) {
+	const uint8_t *reg;
+
+	for (reg = g->regs; *reg != 0; reg++) {
+		WRITE_ONCE(regCache[*reg], -ENODATA);
+	}
+}
+
+static void ionopimax_sched_refresh(struct SchedRegGroup *g) {
+	const uint8_t *reg;
+	int32_t res;
+
+	if (!ionopimax_i2c_lock(I2C_LANE_BULK)) {
+		return;
+	}
+	for (reg = g->regs; *reg != 0; reg++) {
+		if (reg != g->regs && !ionopimax_i2c_yield()) {
+			return;
+		}
+		res = ionopimax_i2c_read_no_lock(*reg, g->len);
+		WRITE_ONCE(regCacheLen[*reg], g->len);
+		WRITE_ONCE(regCache[*reg], res < 0 ? -ENODATA : res);
+	}
+	ionopimax_i2c_unlock();
+}
+
+/*
+ * Earliest deadline first among the groups released by now; deadlines
+ * are implicit, i.e. one period after the release. Returns NULL if no
+ * group is released and sets *next to the earliest future release.
+ */
+static struct SchedRegGroup *ionopimax_sched_pick(ktime_t now, ktime_t *next) {
+	struct SchedRegGroup *g, *best = NULL;
+	ktime_t deadline, bestDeadline = 0;
+	unsigned int period;
+
+	*next = KTIME_MAX;
+	for (g = schedGroups; g->name != NULL; g++) {
+		period = READ_ONCE(g->period_ms);
+		if (period == 0) {
+			continue;
+		}
+		if (ktime_after(g->release, now)) {
+			if (ktime_before(g->release, *next)) {
+				*next = g->release;
+			}
+			continue;
+		}
+		deadline = ktime_add_ms(g->release, period);
+		if (best == NULL || ktime_before(deadline, bestDeadline)) {
+			best = g;
+			bestDeadline = deadline;
+		}
+	}
+	return best;
+}
+
+static int ionopimax_sched_thread(void *data) {
+	struct SchedRegGroup *g;
+	ktime_t now, next, start, busyUntil, windowStart;
+	u64 busy, windowBusy;
+	unsigned int period, budget;
+
+	now = ktime_get();
+	for (g = schedGroups; g->name != NULL; g++) {
+		g->release = now;
+	}
+	busyUntil = now;
+	windowStart = now;
+	windowBusy = 0;
+
+	for (;;) {
+		// set before picking, so that a period change is never missed
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop()) {
+			break;
+		}
+		now = ktime_get();
+
+		if (ktime_sub(now, windowStart) >= SCHED_UTIL_WINDOW_NSEC) {
+			WRITE_ONCE(schedBusUtil, div64_u64(windowBusy * 100,
+					ktime_to_ns(ktime_sub(now, windowStart))));
+			windowStart = now;
+			windowBusy = 0;
+		}
+
+		g = ionopimax_sched_pick(now, &next);
+		if (g != NULL && ktime_before(now, busyUntil)) {
+			// over budget: hold the bus idle
+			next = busyUntil;
+			g = NULL;
+		}
+
+		if (g == NULL) {
+			if (next == KTIME_MAX) {
+				schedule();
+			} else {
+				schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
+			}
+			continue;
+		}
+
+		__set_current_state(TASK_RUNNING);
+		start = now;
+		ionopimax_sched_refresh(g);
+		now = ktime_get();
+
+		busy = ktime_to_ns(ktime_sub(now, start));
+		windowBusy += busy;
+		budget = READ_ONCE(schedBusBudget);
+		if (budget < 100) {
+			busyUntil = ktime_add_ns(now,
+					div_u64(busy * (100 - budget), budget));
+		}
+
+		period = READ_ONCE(g->period_ms);
+		if (ktime_after(now, ktime_add_ms(g->release, period))) {
+			WRITE_ONCE(g->lateCnt, g->lateCnt + 1);
+		}
+		g->release = ktime_add_ms(g->release, period);
+		if (ktime_before(g->release, now)) {
+			g->release = now;
+		}
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static int ionopimax_sched_start(void) {
+	struct task_struct *task;
+
+	task = kthread_run(ionopimax_sched_thread, NULL, "ionopimax_sched");
+	if (IS_ERR(task)) {
+		return PTR_ERR(task);
+	}
+	schedTask = task;
+	return 0;
+}
+
+static void ionopimax_sched_stop(void) {
+	struct SchedRegGroup *g;
+
+	if (schedTask != NULL) {
+		kthread_stop(schedTask);
+		schedTask = NULL;
+	}
+	for (g = schedGroups; g->name != NULL; g++) {
+		ionopimax_sched_invalidate(g);
+	}
+}
+
+static struct SchedRegGroup *ionopimax_sched_get(
+		struct device_attribute *attr) {
+	struct SchedRegGroup *g;
+	size_t len;
+
+	for (g = schedGroups; g->name != NULL; g++) {
+		len = strlen(g->name);
+		if (strncmp(g->name, attr->attr.name, len) == 0
+				&& attr->attr.name[len] == '_') {
+			return g;
+		}
+	}
+	return NULL;
+}
+
+static ssize_t devAttrSchedPeriod_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct SchedRegGroup *g;
+
+	g = ionopimax_sched_get(attr);
+	if (g == NULL) {
+		return -EFAULT;
+	}
+	return sprintf(buf, "%u\n", READ_ONCE(g->period_ms));
+}
+
+static ssize_t devAttrSchedPeriod_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	struct SchedRegGroup *g;
+	int ret;
+	unsigned int val;
+
+	g = ionopimax_sched_get(attr);
+	if (g == NULL) {
+		return -EFAULT;
+	}
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+
+	WRITE_ONCE(g->period_ms, val);
+	if (val == 0) {
+		// stale values must not be served anymore
+		ionopimax_sched_invalidate(g);
+	}
+	if (schedTask != NULL) {
+		wake_up_process(schedTask);
+	}
+
+	return count;
+}
+
+static ssize_t devAttrSchedLateCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	struct SchedRegGroup *g;
+
+	g = ionopimax_sched_get(attr);
+	if (g == NULL) {
+		return -EFAULT;
+	}
+	return sprintf(buf, "%lu\n", READ_ONCE(g->lateCnt));
+}
+
+static ssize_t devAttrSchedBusBudget_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", schedBusBudget);
+}
+
+static ssize_t devAttrSchedBusBudget_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count) {
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret < 0) {
+		return ret;
+	}
+	if (val < 1 || val > 100) {
+		return -EINVAL;
+	}
+	WRITE_ONCE(schedBusBudget, val);
+	return count;
+}
+
+static ssize_t devAttrSchedBusUtil_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%u\n", READ_ONCE(schedBusUtil));
+}
+
+static ssize_t devAttrSchedCacheHitCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(regCacheHitCnt));
+}
+
+static ssize_t devAttrSchedCacheMissCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(regCacheMissCnt));
+}
+
+static ssize_t devAttrSchedCoalescedCnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lu\n", READ_ONCE(i2cFlightCoalescedCnt));
+}
+
+static int ionopimax_regmap_reg_read(void *context, unsigned int reg,
+		unsigned int *val) {
+	int32_t res;
+
+	if (!ionopimax_i2c_lock(ionopimax_i2c_lane(reg))) {
+		return -EBUSY;
+	}
+	res = ionopimax_i2c_read_no_lock(reg, 2);
+	ionopimax_i2c_unlock();
+
+	if (res < 0) {
+		return -EIO;
+	}
+	*val = res;
+	return 0;
+}
+
+static int ionopimax_regmap_reg_write(void *context, unsigned int reg,
+		unsigned int val) {
+	struct WriteVerify wv;
+	bool deferred = false;
+	int32_t res;
+
+	wv.reg = reg;
+	wv.maskedReg = false;
+	wv.mask = 0xffff;
+	wv.val = val;
+
+	if (!ionopimax_i2c_lock(ionopimax_i2c_lane(reg))) {
+		return -EBUSY;
 	}
+	res = ionopimax_i2c_write_policy_no_lock(&wv, &deferred);
+	if (res >= 0) {
+		WRITE_ONCE(regShadow[reg], val);
+	}
+	ionopimax_i2c_unlock();
 
-	switch (baud) {
-	case 0:
-		case 1:
-		regVal = baud;
-		break;
-	case 1200:
-		regVal = 2;
-		break;
-	case 2400:
-		regVal = 3;
-		break;
-	case 4800:
-		regVal = 4;
-		break;
-	case 9600:
-		regVal = 5;
-		break;
-	case 19200:
-		regVal = 6;
-		break;
-	case 38400:
-		regVal = 7;
-		break;
-	case 57600:
-		regVal = 8;
-		break;
-	case 115200:
-		regVal = 9;
-		break;
-	default:
-		return -EINVAL;
+	if (deferred) {
+		ionopimax_write_verify_kick();
 	}
 
-	if (regVal > 1) {
-		if (end + 4 > buf + count) {
-			return -EINVAL;
-		}
+	return res < 0 ? res : 0;
+}
 
-		regVal <<= 8;
-		regVal |= 0x3;
+static bool ionopimax_regmap_readable(struct device *dev, unsigned int reg) {
+	return test_bit(reg, regmapReadable);
+}
 
-		switch (end[1]) {
-		case '7':
-			break;
-		case '8':
-			regVal |= 0x4000;
-			break;
-		default:
-			return -EINVAL;
-		}
+static bool ionopimax_regmap_writeable(struct device *dev, unsigned int reg) {
+	return test_bit(reg, regmapWriteable);
+}
 
-		switch (end[2]) {
-		case 'n':
-			case 'N':
-			break;
-		case 'o':
-			case 'O':
-			regVal |= 0x1000;
-			break;
-		case 'e':
-			case 'E':
-			regVal |= 0x2000;
-			break;
-		default:
-			return -EINVAL;
-		}
+static bool ionopimax_regmap_volatile(struct device *dev, unsigned int reg) {
+	return test_bit(reg, regmapVolatile);
+}
 
-		switch (end[3]) {
-		case '1':
-			break;
-		case '2':
-			regVal |= 0x8000;
-			break;
-		default:
-			return -EINVAL;
+static const struct regmap_config ionopimax_regmap_config = {
+	.name = "mcu",
+	.reg_bits = 8,
+	.val_bits = 16,
+	.max_register = REG_CACHE_SIZE - 1,
+	.reg_read = ionopimax_regmap_reg_read,
+	.reg_write = ionopimax_regmap_reg_write,
+	.readable_reg = ionopimax_regmap_readable,
+	.writeable_reg = ionopimax_regmap_writeable,
+	.volatile_reg = ionopimax_regmap_volatile,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+	.cache_type = REGCACHE_MAPLE,
+#else
+	.cache_type = REGCACHE_RBTREE,
+#endif
+};
+
+/*
+ * Fills the register map bitmaps from the attribute tables. A register is
+ * cached only if every attribute reading it can also write it in plain
+ * bit fields: status registers, registers read and written through
+ * different registers, masked registers, the critical class and the scan
+ * engine outputs are volatile.
+ */
+static void ionopimax_regmap_build(void) {
+	struct DeviceBean *db;
+	struct DeviceAttrBean *dab;
+	const struct DeviceAttrRegSpecs *specs;
+	bool writable;
+	int i, di, ai;
+
+	di = 0;
+	while (devices[di].name != NULL) {
+		db = &devices[di];
+		ai = 0;
+		while (db->devAttrBeans[ai].devAttr.attr.name != NULL) {
+			dab = &db->devAttrBeans[ai];
+			writable = (dab->devAttr.attr.mode & 0222) != 0;
+
+			specs = dab->regSpecs;
+			if (specs != NULL && specs->len == 2) {
+				set_bit(specs->reg, regmapReadable);
+				if (!writable || specs->maskedReg
+						|| dab->regSpecsStore != NULL) {
+					set_bit(specs->reg, regmapVolatile);
+				}
+			}
+
+			specs = dab->regSpecsStore;
+			if (specs == NULL) {
+				specs = dab->regSpecs;
+			}
+			if (writable && specs != NULL && specs->len == 2) {
+				set_bit(specs->reg, regmapWriteable);
+				if (specs->maskedReg) {
+					set_bit(specs->reg, regmapVolatile);
+				}
+			}
+			ai++;
 		}
+		di++;
 	}
 
-	ret = sprintf(regStr, "%d", regVal);
-	if (ret < 1) {
-		return ret;
+	for (i = 0; i < REG_CACHE_SIZE; i++) {
+		if (ionopimax_i2c_lane(i) == I2C_LANE_CRITICAL) {
+			set_bit(i, regmapVolatile);
+		}
 	}
-
-	ret = devAttrI2c_store(dev, attr, regStr, ret);
-	if (ret < 0) {
-		return ret;
+	for (i = 0; i < SCAN_AO_SIZE; i++) {
+		set_bit(scanAoRegs[i], regmapVolatile);
+	}
+	for (i = 0; mcuChangedRegs[i] != 0; i++) {
+		set_bit(mcuChangedRegs[i], regmapVolatile);
 	}
-
-	return count;
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6,5,0)
@@ -4454,7 +5725,9 @@ static int ionopimax_i2c_probe(struct i2c_client *client,
 	}
 
 	i2c_set_clientdata(client, data);
-	mutex_init(&data->update_lock);
+	spin_lock_init(&data->laneLock);
+	init_waitqueue_head(&data->laneQueue);
+	i2cCombined = i2c_check_functionality(client->adapter, I2C_FUNC_I2C);
 
 	ionopimax_i2c_client = client;
 
@@ -4464,6 +5737,16 @@ static int ionopimax_i2c_probe(struct i2c_client *client,
 		return res;
 	}
 
+	ionopimaxRegmap = devm_regmap_init(&client->dev, NULL, client,
+			&ionopimax_regmap_config);
+	if (IS_ERR(ionopimaxRegmap)) {
+		res = PTR_ERR(ionopimaxRegmap);
+		pr_err(LOG_TAG "error initializing register map\n");
+		ionopimaxRegmap = NULL;
+		ionopimax_i2c_client = NULL;
+		return res;
+	}
+
 	pr_info(LOG_TAG "MCU probed addr=0x%02hx FW%d.%d\n",
 		client->addr, fwVerMajor, fwVerMinor);
 
@@ -4475,11 +5758,11 @@ static int ionopimax_i2c_remove(struct i2c_client *client) {
 #else
 static void ionopimax_i2c_remove(struct i2c_client *client) {
 #endif
-	struct ionopimax_i2c_data *data = i2c_get_clientdata(client);
-	mutex_destroy(&data->update_lock);
-
 	pr_info(LOG_TAG "i2c remove addr=0x%02hx\n", client->addr);
 
+	// freed by devm after remove
+	ionopimaxRegmap = NULL;
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(6,0,0)
 	return 0;
 #endif
@@ -4508,25 +5791,81 @@ static struct i2c_driver ionopimax_i2c_driver = {
 	.id_table = ionopimax_i2c_id,
 };
 
+/*
+ * Collects the attributes of a device in its attribute group, to have
+ * them created along with the device in a single call.
+ */
+static int ionopimax_device_group_init(struct DeviceBean *db) {
+	int ai, n;
+
+	n = 0;
+	while (db->devAttrBeans[n].devAttr.attr.name != NULL) {
+		n++;
+	}
+
+	db->attrs = kcalloc(n + 1, sizeof(struct attribute *), GFP_KERNEL);
+	if (db->attrs == NULL) {
+		return -ENOMEM;
+	}
+	for (ai = 0; ai < n; ai++) {
+		db->attrs[ai] = &db->devAttrBeans[ai].devAttr.attr;
+	}
+	db->group.attrs = db->attrs;
+	db->groups[0] = &db->group;
+	db->groups[1] = NULL;
+
+	return 0;
+}
+
+static ASYNC_DOMAIN_EXCLUSIVE(ionopimaxAsyncDomain);
+static ktime_t probeStart;
+
 static void cleanup(void) {
-	struct DeviceBean *db;
-	struct DeviceAttrBean *dab;
-	int i, di, ai;
+	int i, di;
+
+	async_synchronize_full_domain(&ionopimaxAsyncDomain);
+
+	// stop the background pollers before the MCU goes away
+	ionopimax_analog_stop();
+	ionopimax_sys_state_stop();
+	ionopimax_scan_set_ready(false);
+	ionopimax_scan_stop();
+	ionopimax_out_fault_stop();
+	ionopimax_sched_stop();
+	ionopimax_write_verify_stop();
+
+	if (alarmMiscDevRegistered) {
+		misc_deregister(&alarmMiscDev);
+		alarmMiscDevRegistered = false;
+	}
+	if (scanMiscDevRegistered) {
+		misc_deregister(&scanMiscDev);
+		scanMiscDevRegistered = false;
+	}
+	if (scanImage != NULL) {
+		free_page((unsigned long) scanImage);
+		scanImage = NULL;
+	}
+	ionopimax_psy_unregister();
+
+	if (ionopimaxWq != NULL) {
+		destroy_workqueue(ionopimaxWq);
+		ionopimaxWq = NULL;
+	}
+
+	if (wdtRegistered) {
+		watchdog_unregister_device(&wdtDevice);
+		wdtRegistered = false;
+	}
 
 	i2c_del_driver(&ionopimax_i2c_driver);
 
 	di = 0;
 	while (devices[di].name != NULL) {
-		if (devices[di].pDevice && !IS_ERR(devices[di].pDevice)) {
-			db = &devices[di];
-			ai = 0;
-			while (db->devAttrBeans[ai].devAttr.attr.name != NULL) {
-				dab = &db->devAttrBeans[ai];
-				device_remove_file(db->pDevice, &dab->devAttr);
-				ai++;
-			}
-		}
+		// attribute groups are removed with the device
 		device_destroy(pDeviceClass, 0);
+		kfree(devices[di].attrs);
+		devices[di].attrs = NULL;
 		di++;
 	}
 
@@ -4536,6 +5875,10 @@ static void cleanup(void) {
 
 	wiegandDisable(&w1);
 	wiegandDisable(&w2);
+	wiegandFree(&w1);
+	wiegandFree(&w2);
+
+	ateccFree();
 
 	for (i = 0; i < DI_SIZE; i++) {
 		gpioFreeDebounce(&gpioDI[i]);
@@ -4557,16 +5900,35 @@ static void cleanup(void) {
 	gpioFree(&gpioSwReset);
 }
 
-static int ionopimax_init(struct platform_device *pdev) {
-	struct DeviceBean *db;
-	struct DeviceAttrBean *dab;
-	int i, di, ai;
+static struct platform_device *unbindPdev = NULL;
 
-	pr_info(LOG_TAG "init\n");
+/*
+ * Unbinds the driver after a failed deferred init, so that everything
+ * set up is released by remove. Run from a work item as remove waits for
+ * the async domain the init runs in.
+ */
+static void ionopimax_unbind(struct work_struct *work) {
+	device_release_driver(&unbindPdev->dev);
+	put_device(&unbindPdev->dev);
+	unbindPdev = NULL;
+}
 
-	i2c_add_driver(&ionopimax_i2c_driver);
+static DECLARE_WORK(unbindWork, ionopimax_unbind);
 
-	gpioSetPlatformDev(pdev);
+/*
+ * Second part of the probe, run asynchronously once the watchdog, power
+ * and USB controls are available: I/O GPIOs, Wiegand, the sysfs tree, the
+ * character devices, the background pollers and the secure element.
+ * On failure the driver is unbound from the device.
+ */
+static void ionopimax_init_deferred(void *data, async_cookie_t cookie) {
+	struct platform_device *pdev = data;
+	struct DeviceBean *db;
+	ktime_t t0, t1;
+	s64 gpioUs, wiegandUs, sysfsUs, secElemUs;
+	int i, di;
+
+	t0 = ktime_get();
 
 	for (i = 0; i < DI_SIZE; i++) {
 		if (gpioInitDebounce(&gpioDI[i])) {
@@ -4582,6 +5944,128 @@ static int ionopimax_init(struct platform_device *pdev) {
 		pr_err(LOG_TAG "error setting up GPIO %s\n", gpioButton.gpio.name);
 		goto fail;
 	}
+
+	t1 = ktime_get();
+	gpioUs = ktime_us_delta(t1, t0);
+	t0 = t1;
+
+	if (wiegandInit(&w1)) {
+		pr_err(LOG_TAG "error setting up wiegand w1\n");
+		goto fail;
+	}
+	if (wiegandInit(&w2)) {
+		pr_err(LOG_TAG "error setting up wiegand w2\n");
+		goto fail;
+	}
+
+	t1 = ktime_get();
+	wiegandUs = ktime_us_delta(t1, t0);
+	t0 = t1;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,5,0)
+	pDeviceClass = class_create("ionopimax");
+#else
+	pDeviceClass = class_create(THIS_MODULE, "ionopimax");
+#endif
+	if (IS_ERR(pDeviceClass)) {
+		pr_err(LOG_TAG "failed to create device class\n");
+		goto fail;
+	}
+
+	di = 0;
+	while (devices[di].name != NULL) {
+		db = &devices[di];
+		if (ionopimax_device_group_init(db)) {
+			pr_err(LOG_TAG "failed to list attributes of '%s'\n", db->name);
+			goto fail;
+		}
+		db->pDevice = device_create_with_groups(pDeviceClass, NULL, 0, NULL,
+				db->groups, "%s", db->name);
+		if (IS_ERR(db->pDevice)) {
+			pr_err(LOG_TAG "failed to create device '%s'\n", db->name);
+			goto fail;
+		}
+		ionopimax_analog_set_device(db);
+		if (db->devAttrBeans == devAttrBeansSysState) {
+			ionopimax_sys_state_start(db->pDevice);
+		}
+		if (db->devAttrBeans == devAttrBeansDigitalOut) {
+			ionopimax_out_fault_start(db->pDevice);
+		}
+		di++;
+	}
+
+	if (misc_register(&alarmMiscDev)) {
+		pr_err(LOG_TAG "error registering alarms device\n");
+		goto fail;
+	}
+	alarmMiscDevRegistered = true;
+
+	scanImage = (void *) get_zeroed_page(GFP_KERNEL);
+	if (scanImage == NULL) {
+		pr_err(LOG_TAG "error allocating scan image\n");
+		goto fail;
+	}
+	if (misc_register(&scanMiscDev)) {
+		pr_err(LOG_TAG "error registering scan device\n");
+		goto fail;
+	}
+	scanMiscDevRegistered = true;
+	ionopimax_scan_set_ready(true);
+
+	if (ionopimax_sched_start()) {
+		pr_err(LOG_TAG "error starting scheduler\n");
+		goto fail;
+	}
+
+	ionopimax_analog_start();
+
+	t1 = ktime_get();
+	sysfsUs = ktime_us_delta(t1, t0);
+	t0 = t1;
+
+	// cache the serial number, not needed to be ready
+	if (ateccProbe()) {
+		pr_warn(LOG_TAG "secure element not found\n");
+	}
+
+	t1 = ktime_get();
+	secElemUs = ktime_us_delta(t1, t0);
+
+	pr_info(LOG_TAG "ready in %lld us: gpio %lld us, wiegand %lld us, "
+			"sysfs %lld us, sec_elem %lld us\n",
+			ktime_us_delta(t1, probeStart), gpioUs, wiegandUs, sysfsUs,
+			secElemUs);
+	return;
+
+	fail:
+	dev_err(&pdev->dev, "deferred init failed, unbinding\n");
+	get_device(&pdev->dev);
+	unbindPdev = pdev;
+	schedule_work(&unbindWork);
+}
+
+static int ionopimax_init(struct platform_device *pdev) {
+	pr_info(LOG_TAG "init\n");
+	probeStart = ktime_get();
+
+	if (crcSelfTest()) {
+		pr_err(LOG_TAG "CRC self-test failed\n");
+		return -EINVAL;
+	}
+	if (wiegandSelfTest()) {
+		pr_err(LOG_TAG "Wiegand self-test failed\n");
+		return -EINVAL;
+	}
+#ifdef CRC_BENCHMARK
+	crcBenchmark();
+#endif
+
+	ionopimax_regmap_build();
+	i2c_add_driver(&ionopimax_i2c_driver);
+
+	gpioSetPlatformDev(pdev);
+
 	if (gpioInit(&gpioWdEn)) {
 		pr_err(LOG_TAG "error setting up GPIO %s\n", gpioWdEn.name);
 		goto fail;
@@ -4626,42 +6110,28 @@ static int ionopimax_init(struct platform_device *pdev) {
 	gpioSetVal(&gpioSwEn, 0);
 	gpioSetVal(&gpioSwReset, 1);
 
-	wiegandInit(&w1);
-	wiegandInit(&w2);
-
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,5,0)
-	pDeviceClass = class_create("ionopimax");
-#else
-	pDeviceClass = class_create(THIS_MODULE, "ionopimax");
-#endif
-	if (IS_ERR(pDeviceClass)) {
-		pr_err(LOG_TAG "failed to create device class\n");
+	if (ionopimax_wdt_register(pdev)) {
+		pr_err(LOG_TAG "error registering watchdog device\n");
 		goto fail;
 	}
 
-	di = 0;
-	while (devices[di].name != NULL) {
-		db = &devices[di];
-		db->pDevice = device_create(pDeviceClass, NULL, 0, NULL, db->name);
-		if (IS_ERR(db->pDevice)) {
-			pr_err(LOG_TAG "failed to create device '%s'\n", db->name);
-			goto fail;
-		}
+	ionopimaxWq = alloc_workqueue("ionopimax", WQ_HIGHPRI, 0);
+	if (ionopimaxWq == NULL) {
+		pr_err(LOG_TAG "error allocating workqueue\n");
+		goto fail;
+	}
+	ionopimax_write_verify_start();
 
-		ai = 0;
-		while (db->devAttrBeans[ai].devAttr.attr.name != NULL) {
-			dab = &db->devAttrBeans[ai];
-			if (device_create_file(db->pDevice, &dab->devAttr)) {
-				pr_alert(LOG_TAG "failed to create device file '%s/%s'\n",
-						db->name, dab->devAttr.attr.name);
-				goto fail;
-			}
-			ai++;
-		}
-		di++;
+	if (ionopimax_psy_register(pdev)) {
+		pr_err(LOG_TAG "error registering power supplies\n");
+		goto fail;
 	}
 
-	pr_info(LOG_TAG "ready\n");
+	pr_info(LOG_TAG "watchdog and power ready in %lld us\n",
+			ktime_us_delta(ktime_get(), probeStart));
+
+	async_schedule_domain(ionopimax_init_deferred, pdev,
+			&ionopimaxAsyncDomain);
 	return 0;
 
 	fail:
@@ -4689,6 +6159,7 @@ static struct platform_driver ionopimax_driver = {
 		.name = "ionopimax",
 		.owner = THIS_MODULE,
 		.of_match_table = ionopimax_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	}
 };
 
@@ -4697,4 +6168,15 @@ MODULE_AUTHOR("Sfera Labs - http://sferalabs.cc");
 MODULE_DESCRIPTION("Iono Pi Max driver module");
 MODULE_VERSION(IONOPIMAX_MODULE_VERSION);
 
-module_platform_driver(ionopimax_driver);
+static int __init ionopimax_module_init(void) {
+	return platform_driver_register(&ionopimax_driver);
+}
+
+static void __exit ionopimax_module_exit(void) {
+	platform_driver_unregister(&ionopimax_driver);
+	// an unbind requested by a failed deferred init may still be running
+	flush_work(&unbindWork);
+}
+
+module_init(ionopimax_module_init);
+module_exit(ionopimax_module_exit);